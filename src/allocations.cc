@@ -0,0 +1,91 @@
+/*
+ *  Winter is a UCI chess engine.
+ *
+ *  Copyright (C) 2016 Jonas Kuratli, Jonathan Maurer, Jonathan Rosenthal
+ *  Copyright (C) 2017-2018 Jonathan Rosenthal
+ *
+ *  Winter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Winter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * allocations.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonathan Rosenthal
+ */
+
+#include "allocations.h"
+
+#ifdef TRACK_ALLOCATIONS
+#include <cstdlib>
+#include <new>
+#endif
+
+namespace {
+
+// Plain integers, so the counters need no thread local initialization, which
+// could itself allocate.
+thread_local size_t thread_allocations = 0;
+thread_local size_t thread_bytes = 0;
+
+#ifdef TRACK_ALLOCATIONS
+void *Allocate(size_t size) {
+  ++thread_allocations;
+  thread_bytes += size;
+  void *ptr = std::malloc(size ? size : 1);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void *AllocateAligned(size_t size, std::align_val_t alignment) {
+  ++thread_allocations;
+  thread_bytes += size;
+  const size_t align = static_cast<size_t>(alignment);
+  // aligned_alloc requires the size to be a multiple of the alignment.
+  void *ptr = std::aligned_alloc(align, ((size ? size : 1) + align - 1) / align * align);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+#endif
+
+}
+
+namespace allocations {
+
+Counts GetThreadCounts() {
+  return { thread_allocations, thread_bytes };
+}
+
+}
+
+#ifdef TRACK_ALLOCATIONS
+
+void *operator new(size_t size) { return Allocate(size); }
+void *operator new[](size_t size) { return Allocate(size); }
+void *operator new(size_t size, std::align_val_t alignment) { return AllocateAligned(size, alignment); }
+void *operator new[](size_t size, std::align_val_t alignment) { return AllocateAligned(size, alignment); }
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+#endif
@@ -0,0 +1,64 @@
+/*
+ *  Winter is a UCI chess engine.
+ *
+ *  Copyright (C) 2016 Jonas Kuratli, Jonathan Maurer, Jonathan Rosenthal
+ *  Copyright (C) 2017-2018 Jonathan Rosenthal
+ *
+ *  Winter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Winter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * allocations.h
+ *
+ * Optional counting of heap allocations. Building with TRACK_ALLOCATIONS=1
+ * replaces the global operator new and delete, which then count every
+ * allocation of the calling thread.
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonathan Rosenthal
+ */
+
+#ifndef SRC_ALLOCATIONS_H_
+#define SRC_ALLOCATIONS_H_
+
+#include <cstddef>
+
+namespace allocations {
+
+#ifdef TRACK_ALLOCATIONS
+constexpr bool kEnabled = true;
+#else
+constexpr bool kEnabled = false;
+#endif
+
+struct Counts {
+  size_t allocations = 0;
+  size_t bytes = 0;
+
+  Counts operator-(const Counts other) const {
+    return { allocations - other.allocations, bytes - other.bytes };
+  }
+  Counts &operator+=(const Counts other) {
+    allocations += other.allocations;
+    bytes += other.bytes;
+    return *this;
+  }
+};
+
+// Allocations made by the calling thread since it started. Always zero unless
+// tracking is enabled.
+Counts GetThreadCounts();
+
+}
+
+#endif /* SRC_ALLOCATIONS_H_ */
@@ -34,6 +34,7 @@
 #include "general/settings.h"
 #include "general/types.h"
 #include "benchmark.h"
+#include "allocations.h"
 #include <fstream>
 #include <string>
 #include <sstream>
@@ -42,6 +43,13 @@
 #include <cmath>
 #include <chrono>
 
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 namespace {
 
 double ResultAbsLoss(Score x, Score y) {
@@ -95,6 +103,58 @@ std::vector<std::string> split(const std::string &s, char delim) {
     return elems;
 }
 
+// Counts hardware cache events of the calling thread. If the kernel does not
+// give access to performance counters, valid() returns false.
+enum class CacheLevel {
+  kL1D, kLLC
+};
+
+struct CacheEventCounter {
+#if defined(__linux__)
+  CacheEventCounter(CacheLevel level) {
+    const uint64_t cache = level == CacheLevel::kL1D ? PERF_COUNT_HW_CACHE_L1D
+                                                     : PERF_COUNT_HW_CACHE_LL;
+    perf_event_attr attr{};
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.size = sizeof(attr);
+    attr.config = cache | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+  ~CacheEventCounter() {
+    if (valid()) {
+      close(fd);
+    }
+  }
+  void start() {
+    if (valid()) {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+  uint64_t stop() {
+    uint64_t count = 0;
+    if (valid()) {
+      ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+      if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+        count = 0;
+      }
+    }
+    return count;
+  }
+  bool valid() const { return fd >= 0; }
+  int fd = -1;
+#else
+  CacheEventCounter(CacheLevel) {}
+  void start() {}
+  uint64_t stop() { return 0; }
+  bool valid() const { return false; }
+#endif
+};
+
 struct PerftTest {
   std::string fen;
   std::vector<Depth> depths;
@@ -216,6 +276,31 @@ int TimeToDepthSuite() {
   return total_time.count();
 }
 
+void RunTimeToDepthCommand(int argc, char **argv) {
+  std::vector<size_t> thread_counts;
+  for (int i = 2; i < argc; ++i) {
+    thread_counts.push_back(std::max(1, atoi(argv[i])));
+  }
+  if (thread_counts.empty()) {
+    thread_counts.push_back(1);
+  }
+
+  search::set_print_info(false);
+  std::vector<int> times;
+  for (size_t num_threads : thread_counts) {
+    search::Threads.set_num_threads(num_threads);
+    table::ClearTable();
+    search::clear_killers_and_counter_moves();
+    times.push_back(std::max(1, TimeToDepthSuite()));
+  }
+  search::set_print_info(true);
+
+  std::cout << "\nthreads    time (ms)    speedup" << std::endl;
+  for (size_t i = 0; i < thread_counts.size(); ++i) {
+    printf("%7zu %12d %10.2f\n", thread_counts[i], times[i], (double)times[0] / times[i]);
+  }
+}
+
 double RunEvalTestSet(const std::vector<EvaluationTest> &test_set) {
   double error_sum = 0;
   for (const EvaluationTest &sample : test_set) {
@@ -279,6 +364,113 @@ std::array<std::string, 50> kBenchmarkCommandPositions {
   "2r2b2/5p2/5k2/p1r1pP2/P2pB3/1P3P2/K1P3R1/7R w - - 23 93" // h1h8/h1h7 +1.6, a2b1 +1.5
 };
 
+// Returns the bench positions and all positions reachable from them in one move.
+std::vector<Board> GetEvalBenchBoards() {
+  std::vector<Board> boards;
+  for (const std::string &fen : kBenchmarkCommandPositions) {
+    Board board;
+    board.SetBoard(split(fen, ' '));
+    boards.push_back(board);
+    for (Move move : board.GetMoves<kNonQuiescent>()) {
+      board.Make(move);
+      boards.push_back(board);
+      board.UnMake();
+    }
+  }
+  return boards;
+}
+
+// Compares the quantized network against the float network on the eval bench positions.
+void QuantizationSuite() {
+  constexpr size_t kRepetitions = 20;
+  const std::vector<Board> boards = GetEvalBenchBoards();
+
+  const bool was_quantized = net_evaluation::GetQuantized();
+  std::array<std::vector<Score>, 2> scores;
+  // Both paths are timed in alternating rounds and the fastest round counts, so
+  // neither path is favoured by warm caches or frequency changes.
+  constexpr size_t kRounds = 5;
+  std::array<std::chrono::microseconds, 2> times;
+  times.fill(std::chrono::microseconds::max());
+  for (size_t round = 0; round < kRounds; ++round) {
+    for (size_t quantized = 0; quantized < 2; ++quantized) {
+      net_evaluation::SetQuantized(quantized);
+      Time start = now();
+      for (size_t rep = 0; rep < kRepetitions; ++rep) {
+        scores[quantized].clear();
+        for (const Board &board : boards) {
+          scores[quantized].emplace_back(net_evaluation::ScoreBoard(board));
+        }
+      }
+      times[quantized] = std::min(times[quantized],
+          std::chrono::duration_cast<std::chrono::microseconds>(now() - start));
+    }
+  }
+  net_evaluation::SetQuantized(was_quantized);
+
+  double win_drift = 0, loss_drift = 0, cp_drift = 0;
+  double max_win_drift = 0, max_loss_drift = 0, max_cp_drift = 0;
+  for (size_t i = 0; i < boards.size(); ++i) {
+    double win = std::abs(scores[0][i].get_win_probability() - scores[1][i].get_win_probability());
+    double loss = std::abs(scores[0][i].get_loss_probability() - scores[1][i].get_loss_probability());
+    double cp = std::abs(scores[0][i].to_cp() - scores[1][i].to_cp()) / 8.0;
+    win_drift += win;
+    loss_drift += loss;
+    cp_drift += cp;
+    max_win_drift = std::max(max_win_drift, win);
+    max_loss_drift = std::max(max_loss_drift, loss);
+    max_cp_drift = std::max(max_cp_drift, cp);
+  }
+
+  const size_t evals = boards.size() * kRepetitions;
+  printf("Positions: %d\n", (int)boards.size());
+  printf("Drift   win: avg %.5f max %.5f  loss: avg %.5f max %.5f  cp: avg %.2f max %.2f\n",
+         win_drift / boards.size(), max_win_drift, loss_drift / boards.size(), max_loss_drift,
+         cp_drift / boards.size(), max_cp_drift);
+  const double float_rate = 1e6 * evals / (times[0].count() + 1);
+  const double quantized_rate = 1e6 * evals / (times[1].count() + 1);
+  printf("Float:     %8d evals/s\n", (int)float_rate);
+  printf("Quantized: %8d evals/s  (%.2fx)\n", (int)quantized_rate, quantized_rate / float_rate);
+}
+
+// Measures full network evaluations from scratch, which is dominated by the piece
+// relation loops, along with the cache misses they cause.
+void EvalBench() {
+  constexpr size_t kRepetitions = 20;
+  const std::vector<Board> boards = GetEvalBenchBoards();
+  const size_t evals = boards.size() * kRepetitions;
+  const bool was_quantized = net_evaluation::GetQuantized();
+
+  printf("Positions: %d\n", (int)boards.size());
+  for (size_t quantized = 0; quantized < 2; ++quantized) {
+    net_evaluation::SetQuantized(quantized);
+    CacheEventCounter l1_misses(CacheLevel::kL1D);
+    CacheEventCounter llc_misses(CacheLevel::kLLC);
+    l1_misses.start();
+    llc_misses.start();
+    Time start = now();
+    for (size_t rep = 0; rep < kRepetitions; ++rep) {
+      for (const Board &board : boards) {
+        net_evaluation::ScoreBoard(board);
+      }
+    }
+    auto time_used = std::chrono::duration_cast<Milliseconds>(now() - start);
+    const uint64_t l1 = l1_misses.stop();
+    const uint64_t llc = llc_misses.stop();
+
+    printf("%-10s %8d evals/s", quantized ? "Quantized:" : "Float:",
+           (int)(1000 * evals / (time_used.count() + 1)));
+    if (l1_misses.valid() && llc_misses.valid()) {
+      printf("  L1D misses/eval %8.1f  LLC misses/eval %6.2f\n",
+             (double)l1 / evals, (double)llc / evals);
+    }
+    else {
+      printf("  cache miss counters unavailable\n");
+    }
+  }
+  net_evaluation::SetQuantized(was_quantized);
+}
+
 // This function and the list of FENs above is heavily based on code found in Ethereal by Adrew Grant
 void RunBenchCommand(int argc, char **argv) {
   Board board;
@@ -289,6 +481,13 @@ void RunBenchCommand(int argc, char **argv) {
   std::array<int64_t, 256> nodes;
   std::array<Move, 256> bestMoves;
 
+  // Heap allocations and nodes of every thread, only collected with TRACK_ALLOCATIONS.
+  struct ThreadAllocations {
+    allocations::Counts counts;
+    size_t nodes;
+  };
+  std::vector<std::vector<ThreadAllocations>> thread_allocations(kBenchmarkCommandPositions.size());
+
   int depth     = argc > 2 ? atoi(argv[2]) :11;
   int num_threads  = argc > 3 ? atoi(argv[3]) :  1;
   int megabytes = argc > 4 ? atoi(argv[4]) : 16;
@@ -308,6 +507,13 @@ void RunBenchCommand(int argc, char **argv) {
     scores[i] = search::get_last_search_score();
     times[i] = std::chrono::duration_cast<Milliseconds>(now() - start);
     nodes[i] = search::get_num_nodes();
+    if (allocations::kEnabled) {
+      thread_allocations[i].push_back({ search::Threads.main_thread->search_allocations,
+                                        search::Threads.main_thread->nodes.load() });
+      for (const search::Thread *t : search::Threads.helpers) {
+        thread_allocations[i].push_back({ t->search_allocations, t->nodes.load() });
+      }
+    }
 
     table::ClearTable(); // Reset TT between searches
     search::clear_killers_and_counter_moves();
@@ -325,6 +531,28 @@ void RunBenchCommand(int argc, char **argv) {
            bestStr.c_str(), (int)nodes[i], (int)(1000 * nodes[i] / (times[i].count() + 1)));
   }
 
+  if (allocations::kEnabled) {
+    printf("\nHeap allocations during search\n");
+    std::vector<ThreadAllocations> totals(search::Threads.get_thread_count());
+    for (int i = 0; i < kBenchmarkCommandPositions.size(); i++) {
+      for (size_t id = 0; id < thread_allocations[i].size(); ++id) {
+        const ThreadAllocations &stats = thread_allocations[i][id];
+        printf("Bench [# %2d] thread %2d %8zu allocs %10zu bytes %10.5f allocs/node %10.3f bytes/node\n",
+               i + 1, (int)id, stats.counts.allocations, stats.counts.bytes,
+               (double)stats.counts.allocations / std::max(stats.nodes, (size_t)1),
+               (double)stats.counts.bytes / std::max(stats.nodes, (size_t)1));
+        totals[id].counts += stats.counts;
+        totals[id].nodes += stats.nodes;
+      }
+    }
+    for (size_t id = 0; id < totals.size(); ++id) {
+      printf("Total        thread %2d %8zu allocs %10zu bytes %10.5f allocs/node %10.3f bytes/node\n",
+             (int)id, totals[id].counts.allocations, totals[id].counts.bytes,
+             (double)totals[id].counts.allocations / std::max(totals[id].nodes, (size_t)1),
+             (double)totals[id].counts.bytes / std::max(totals[id].nodes, (size_t)1));
+    }
+  }
+
   printf("==================================================================\n");
 
   // Report the overall statistics
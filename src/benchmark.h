@@ -34,8 +34,13 @@ namespace benchmark {
 int TimeToDepthSuite();
 void PerftSuite(std::string filename);
 void SymmetrySuite();
+void QuantizationSuite();
+void EvalBench();
 
 void RunBenchCommand(int argc, char **argv);
+// Runs the time to depth suite for each thread count given on the command line
+// and reports the speedup relative to the first.
+void RunTimeToDepthCommand(int argc, char **argv);
 
 }
 
@@ -37,6 +37,7 @@
 #include <array>
 #include <cassert>
 #include <cctype>
+#include <cstring>
 
 namespace hash {
 
@@ -235,34 +236,8 @@ constexpr std::array<Square, 4> castling_king_des = {
 BitBoard all_castling_squares = castling_relevant_bbs[0] | castling_relevant_bbs[1]
                               | castling_relevant_bbs[2] | castling_relevant_bbs[3];
 
-//Define helper functions for move history information
-void SaveEnPassant(MoveHistoryInformation &info, Square ep) {
-  info |= (ep << 4);
-}
-Square GetEnPassant(const MoveHistoryInformation info) {
-  return (info >> 4) & 0x3F;
-}
-void SaveMovingPiece(MoveHistoryInformation &info, Piece piece) {
-  info |= piece;
-}
-Piece GetMovingPiece(const MoveHistoryInformation info) {
-  return info & 0xF;
-}
-void SaveCastlingRights(MoveHistoryInformation &info, CastlingRights rights) {
-  info |= rights << 10;
-}
-CastlingRights GetCastlingRights(const MoveHistoryInformation info) {
-  return (info >> 10) & 0xF;
-}
-void SaveFiftyMoveCount(MoveHistoryInformation &info, int32_t count) {
-  info |= count << 14;
-}
-int32_t GetFiftyMoveCount(const MoveHistoryInformation info) {
-  return (info >> 14) & 0x7F;
-}
-
 template<int Quiescent>
-void AddMoves(std::vector<Move> &move_list, Square source_square, BitBoard destinations,
+void AddMoves(MoveList &move_list, Square source_square, BitBoard destinations,
               BitBoard enemy_pieces) {
   for (BitBoard captures = destinations & enemy_pieces; captures; bitops::PopLSB(captures)) {
     Square destination_square = bitops::NumberOfTrailingZeros(captures);
@@ -277,7 +252,7 @@ void AddMoves(std::vector<Move> &move_list, Square source_square, BitBoard desti
 }
 
 template<int Quiescent, MoveGenType move_gen_type, int PieceType>
-void AddMoves(std::vector<Move> &moves, std::vector<Move> &legal_moves, BitBoard piece_bitboard,
+void AddMoves(MoveList &moves, MoveList &legal_moves, BitBoard piece_bitboard,
               const BitBoard own_pieces, const BitBoard enemy_pieces,
               const BitBoard all_pieces, const BitBoard critical) {
   if (move_gen_type == MoveGenType::Normal) {
@@ -302,7 +277,7 @@ void AddMoves(std::vector<Move> &moves, std::vector<Move> &legal_moves, BitBoard
 }
 
 template<int Quiescent>
-inline void AddPromotionMoves(const Square src, const Square des, std::vector<Move> &moves) {
+inline void AddPromotionMoves(const Square src, const Square des, MoveList &moves) {
   moves.emplace_back(GetMove(src, des, kQueenPromotion));
   moves.emplace_back(GetMove(src, des, kKnightPromotion));
   if (Quiescent == kNonQuiescent) {
@@ -313,7 +288,7 @@ inline void AddPromotionMoves(const Square src, const Square des, std::vector<Mo
 
 template<int Quiescent, MoveGenType move_gen_type, Color point_of_view>
 inline void ConditionalAddPromotionMoves(const Square src, const Square des,
-                                         std::vector<Move> &moves,
+                                         MoveList &moves,
                                          const MoveType move_type) {
   const int back_rank = point_of_view == kWhite ? 7 : 0;
   if (move_gen_type != MoveGenType::Fast || GetSquareY(des) != back_rank) {
@@ -325,7 +300,7 @@ inline void ConditionalAddPromotionMoves(const Square src, const Square des,
 }
 
 inline void AddNonPromotionMovesLoop(BitBoard des, const Square square_dif,
-                                     std::vector<Move> &moves,
+                                     MoveList &moves,
                                      const MoveType move_type) {
   for (; des; bitops::PopLSB(des)) {
     const Square destination = bitops::NumberOfTrailingZeros(des);
@@ -335,7 +310,7 @@ inline void AddNonPromotionMovesLoop(BitBoard des, const Square square_dif,
 
 template<int Quiescent, MoveGenType move_gen_type, Color point_of_view>
 inline void AddPawnMovesLoop(BitBoard des, const Square square_dif,
-                             std::vector<Move> &moves,
+                             MoveList &moves,
                              const MoveType move_type) {
   for (; des; bitops::PopLSB(des)) {
     const Square destination = bitops::NumberOfTrailingZeros(des);
@@ -347,7 +322,7 @@ inline void AddPawnMovesLoop(BitBoard des, const Square square_dif,
 template<int Quiescent, MoveGenType move_gen_type, Color point_of_view>
 inline void AddPawnMoves(const BitBoard pawn_bb, const BitBoard empty,
                          const BitBoard enemy_pieces, const Square en_passant,
-                         std::vector<Move> &moves, const BitBoard critical) {
+                         MoveList &moves, const BitBoard critical) {
   const BitBoard double_push_row = point_of_view == kWhite ? bitops::fourth_rank : bitops::fifth_rank;
   const int f_east = point_of_view == kWhite ? kNorthEast : kSouthEast;
   const int f_west = point_of_view == kWhite ? kNorthWest : kSouthWest;
@@ -424,7 +399,8 @@ Board::Board() {
   for (size_t idx = 0; idx < kNumRngHash; ++idx) {
     rng_hash[idx] = 0;
   }
-  previous_hashes.clear();
+  states.clear();
+  history_offset = 0;
   en_passant = 0;
   fifty_move_count = 0;
   for (int player = kWhite; player <= kBlack; ++player) {
@@ -531,9 +507,8 @@ std::vector<std::string> Board::GetFen() const {
 }
 
 void Board::SetBoard(std::vector<std::string> fen_tokens){
-  move_history.clear();
-  move_history_information.clear();
-  previous_hashes.clear();
+  states.clear();
+  history_offset = 0;
   hash = 0;
   pawn_hash = 0;
   major_hash = 0;
@@ -721,36 +696,35 @@ void Board::SetToSamePosition(const Board &board) {
   hash = board.hash;
   pawn_hash = board.pawn_hash;
   major_hash = board.major_hash;
-  for (size_t idx = 0; idx < kNumRngHash; ++idx) {
-    rng_hash[idx] = board.rng_hash[idx];;
-  }
+  rng_hash = board.rng_hash;
   en_passant = board.en_passant;
   fifty_move_count = board.fifty_move_count;
-  move_history = board.move_history;
-  move_history_information = board.move_history_information;
-  previous_hashes = board.previous_hashes;
-  for (int player = kWhite; player <= kBlack; player++) {
-    color_bitboards[player] = board.color_bitboards[player];
-    for (int piece_type = 0; piece_type < kNumPieceTypes - 1; ++piece_type) {
-      piece_counts[player][piece_type] = board.piece_counts[player][piece_type];
-    }
-  }
-  for (int piece_type = 0; piece_type < kNumPieceTypes - 1; ++piece_type) {
-    pt_bitboards[piece_type] = board.pt_bitboards[piece_type];
-  }
-  for (Square square = parse::StringToSquare("a1");
-      square <= parse::StringToSquare("h8"); square++) {
-    pieces[square] = board.pieces[square];
-  }
+  // Older moves can not be repeated, so only the moves since the last capture or
+  // pawn move are copied, and at least the last move. The capacity left over
+  // from earlier searches is reused.
+  const size_t num_states = std::min(board.states.size(),
+                                     std::max((size_t)fifty_move_count, (size_t)1));
+  states.reserve(num_states + 2 * settings::kMaxDepth);
+  states.assign(board.states.end() - num_states, board.states.end());
+  history_offset = board.history_offset + board.states.size() - num_states;
+  // Fixed size copies are inlined, std::copy would call memmove for each array.
+  std::memcpy(color_bitboards, board.color_bitboards, sizeof(color_bitboards));
+  std::memcpy(pt_bitboards, board.pt_bitboards, sizeof(pt_bitboards));
+  std::memcpy(piece_counts, board.piece_counts, sizeof(piece_counts));
+  std::memcpy(pieces, board.pieces, sizeof(pieces));
   castling_rights = board.castling_rights;
   turn = board.turn;
 }
 
+template<bool update_hashes>
 void Board::AddPiece(const Square square, const Piece piece) {
   pt_bitboards[GetPieceType(piece)] |= GetSquareBitBoard(square);
   color_bitboards[GetPieceColor(piece)] |= GetSquareBitBoard(square);
   piece_counts[GetPieceColor(piece)][GetPieceType(piece)]++;
   pieces[square] = piece;
+  if (!update_hashes) {
+    return;
+  }
   hash ^= hash::get_hash(piece, square);
   pawn_hash ^= hash::get_pawn_hash(piece, square);
   major_hash ^= hash::get_major_hash(piece, square);
@@ -759,6 +733,7 @@ void Board::AddPiece(const Square square, const Piece piece) {
   }
 }
 
+template<bool update_hashes>
 Piece Board::RemovePiece(const Square square) {
   Piece piece = pieces[square];
   if (GetPieceType(piece) != kNoPiece) {
@@ -766,19 +741,22 @@ Piece Board::RemovePiece(const Square square) {
     pt_bitboards[GetPieceType(piece)] ^= GetSquareBitBoard(square);
     color_bitboards[GetPieceColor(piece)] ^= GetSquareBitBoard(square);
     piece_counts[GetPieceColor(piece)][GetPieceType(piece)]--;
-    hash ^= hash::get_hash(piece, square);
-    pawn_hash ^= hash::get_pawn_hash(piece, square);
-    major_hash ^= hash::get_major_hash(piece, square);
-    for (size_t idx = 0; idx < kNumRngHash; ++idx) {
-      rng_hash[idx] ^= hash::get_rng_hash(piece, square, idx);
+    if (update_hashes) {
+      hash ^= hash::get_hash(piece, square);
+      pawn_hash ^= hash::get_pawn_hash(piece, square);
+      major_hash ^= hash::get_major_hash(piece, square);
+      for (size_t idx = 0; idx < kNumRngHash; ++idx) {
+        rng_hash[idx] ^= hash::get_rng_hash(piece, square, idx);
+      }
     }
   }
   return piece;
 }
 
+template<bool update_hashes>
 Piece Board::MovePiece(const Square source, const Square destination) {
-  Piece piece = RemovePiece(destination);
-  AddPiece(destination, RemovePiece(source));
+  Piece piece = RemovePiece<update_hashes>(destination);
+  AddPiece<update_hashes>(destination, RemovePiece<update_hashes>(source));
   assert(pieces[source] == kNoPiece);
   assert(pieces[destination] != kNoPiece);
   return piece;
@@ -790,15 +768,28 @@ void Board::SwapTurn() {
 }
 
 void Board::Make(const Move move) {
-  MoveHistoryInformation information = 0;
-  previous_hashes.emplace_back(get_hash());
+  StateInfo &state = states.emplace_back();
+  state.move = move;
+  state.key = get_hash();
+  state.hash = hash;
+  state.pawn_hash = pawn_hash;
+  state.major_hash = major_hash;
+  state.rng_hash = rng_hash;
+  state.castling_rights = castling_rights;
+  state.en_passant = en_passant;
+  state.fifty_move_count = fifty_move_count;
+  state.captured = kNoPiece;
+  MoveDelta &delta = state.delta;
   if (move != kNullMove && GetMoveType(move) != kCastle) {
-    SaveMovingPiece(information, RemovePiece(GetMoveDestination(move)));
+    Piece captured = RemovePiece(GetMoveDestination(move));
+    state.captured = captured;
+    if (captured != kNoPiece) {
+      delta.Remove(captured, GetMoveDestination(move));
+    }
+    delta.Remove(pieces[GetMoveSource(move)], GetMoveSource(move));
+    delta.Add(pieces[GetMoveSource(move)], GetMoveDestination(move));
     MovePiece(GetMoveSource(move),GetMoveDestination(move));
   }
-  SaveEnPassant(information, en_passant);
-  SaveCastlingRights(information, castling_rights);
-  SaveFiftyMoveCount(information, fifty_move_count);
   //We default our ep square to a place the opponent will never be able to ep.
   en_passant = 0;
   fifty_move_count++;
@@ -817,20 +808,28 @@ void Board::Make(const Move move) {
       assert(GetMoveSource(move) == castling_king_origins[castling_type]);
       Piece king = RemovePiece(castling_king_origins[castling_type]);
       assert(GetPieceType(king) == kKing);
+      delta.Remove(king, castling_king_origins[castling_type]);
       if (castling_rook_des[castling_type] != castling_rook_origins[castling_type]) {
+        delta.Remove(pieces[castling_rook_origins[castling_type]],
+                     castling_rook_origins[castling_type]);
+        delta.Add(pieces[castling_rook_origins[castling_type]],
+                  castling_rook_des[castling_type]);
         MovePiece(castling_rook_origins[castling_type], castling_rook_des[castling_type]);
       }
       AddPiece(castling_king_des[castling_type], king);
+      delta.Add(king, castling_king_des[castling_type]);
     }
     break;
   case kEnPassant:
-    RemovePiece(GetMoveDestination(move) - 8 + (2*8) * get_turn());
+    delta.Remove(RemovePiece(GetMoveDestination(move) - 8 + (2*8) * get_turn()),
+                 GetMoveDestination(move) - 8 + (2*8) * get_turn());
     break;
   default:
     if (GetMoveType(move) >= kKnightPromotion) {
       RemovePiece(GetMoveDestination(move));
       AddPiece(GetMoveDestination(move),
           GetPiece(get_turn(), GetMoveType(move) - kKnightPromotion + kKnight));
+      delta.added[0].first = pieces[GetMoveDestination(move)];
     }
     break;
   }
@@ -845,50 +844,49 @@ void Board::Make(const Move move) {
       }
     }
   }
-  move_history_information.emplace_back(information);
-  move_history.emplace_back(move);
   SwapTurn();
 }
 
 void Board::UnMake() {
-  SwapTurn();
-  Move move = move_history.back();
-  move_history.pop_back();
-  MoveHistoryInformation info = move_history_information.back();
-  move_history_information.pop_back();
-  previous_hashes.pop_back();
+  const StateInfo &state = states.back();
+  const Move move = state.move;
+  turn ^= 0x1;
   if (move != kNullMove && GetMoveType(move) != kCastle) {
-    AddPiece(GetMoveSource(move), RemovePiece(GetMoveDestination(move)));
-    Piece piece = GetMovingPiece(info);
-    if (GetPieceType(piece) != kNoPiece) {
-      AddPiece(GetMoveDestination(move), piece);
+    AddPiece<false>(GetMoveSource(move), RemovePiece<false>(GetMoveDestination(move)));
+    if (GetPieceType(state.captured) != kNoPiece) {
+      AddPiece<false>(GetMoveDestination(move), state.captured);
     }
   }
-  en_passant = GetEnPassant(info);
-  castling_rights = GetCastlingRights(info);
-  fifty_move_count = GetFiftyMoveCount(info);
+  en_passant = state.en_passant;
+  castling_rights = state.castling_rights;
+  fifty_move_count = state.fifty_move_count;
   switch(GetMoveType(move)) {
   case kEnPassant:
-    AddPiece(GetMoveDestination(move) - 8 + (2*8) * get_turn(), GetPiece(get_not_turn(), kPawn));
+    AddPiece<false>(GetMoveDestination(move) - 8 + (2*8) * get_turn(), GetPiece(get_not_turn(), kPawn));
     break;
   case kCastle:
     {
       int castling_type = (2 * turn) + (GetMoveSource(move) > GetMoveDestination(move));
-      Piece king = RemovePiece(castling_king_des[castling_type]);
+      Piece king = RemovePiece<false>(castling_king_des[castling_type]);
       assert(GetPieceType(king) == kKing);
       if (castling_rook_des[castling_type] != castling_rook_origins[castling_type]) {
-        MovePiece(castling_rook_des[castling_type], castling_rook_origins[castling_type]);
+        MovePiece<false>(castling_rook_des[castling_type], castling_rook_origins[castling_type]);
       }
-      AddPiece(castling_king_origins[castling_type], king);
+      AddPiece<false>(castling_king_origins[castling_type], king);
     }
     break;
   default:
     if (GetMoveType(move) >= kKnightPromotion) {
-      RemovePiece(GetMoveSource(move));
-      AddPiece(GetMoveSource(move), GetPiece(get_turn(), kPawn));
+      RemovePiece<false>(GetMoveSource(move));
+      AddPiece<false>(GetMoveSource(move), GetPiece(get_turn(), kPawn));
     }
     break;
   }
+  hash = state.hash;
+  pawn_hash = state.pawn_hash;
+  major_hash = state.major_hash;
+  rng_hash = state.rng_hash;
+  states.pop_back();
 }
 
 void Board::Print() const {
@@ -942,23 +940,12 @@ BitBoard Board::PlayerBitBoardControl(Color color, BitBoard all_pieces) const {
 }
 
 template<int Quiescent, int _move_gen_type>
-std::vector<Move> Board::GetMoves(const BitBoard critical) {
+void Board::GetMoves(MoveList &legal_moves, const BitBoard critical) {
   constexpr MoveGenType move_gen_type = static_cast<MoveGenType>(_move_gen_type);
-  std::vector<Move> moves;
-  std::vector<Move> legal_moves;
-
-  const int expected_num_moves = Quiescent == kQuiescent ? 16 : 48;
-  if (move_gen_type == MoveGenType::InCheck) {
-    legal_moves.reserve(expected_num_moves / 4);
-    moves.reserve(expected_num_moves / 2);
-  }
-  else if (move_gen_type == MoveGenType::Fast) {
-    moves.reserve(expected_num_moves);
-  }
-  else {
-    legal_moves.reserve(expected_num_moves);
-    moves.reserve(expected_num_moves);
-  }
+  // Without pins or checks all pseudo legal moves are legal and generated
+  // straight into the output list.
+  MoveList pseudo_legal_moves;
+  MoveList &moves = move_gen_type == MoveGenType::Fast ? legal_moves : pseudo_legal_moves;
 
   const BitBoard own_pieces = color_bitboards[get_turn()];
   const BitBoard enemy_pieces = color_bitboards[get_not_turn()];
@@ -1025,7 +1012,7 @@ std::vector<Move> Board::GetMoves(const BitBoard critical) {
   }
 
   if (move_gen_type == MoveGenType::Fast) {
-    return moves;
+    return;
   }
 
   //Now we need to remove illegal moves.
@@ -1070,11 +1057,11 @@ std::vector<Move> Board::GetMoves(const BitBoard critical) {
     }
 
   }
-  return legal_moves;
 }
 
 template<int Quiescent>
-std::vector<Move> Board::GetMoves() {
+MoveList Board::GetMoves() {
+  MoveList moves;
   Square king_square = bitops::NumberOfTrailingZeros(get_piece_bitboard(get_turn(), kKing));
   BitBoard danger = magic::GetAttackMap<kKnight>(king_square, 0) & get_piece_bitboard(get_not_turn(), kKnight);
   danger |= magic::GetAttackMap<kRook>(king_square, 0)
@@ -1085,7 +1072,8 @@ std::vector<Move> Board::GetMoves() {
   danger |= ((bitops::SE(enemy_pawns) | bitops::SW(enemy_pawns)) << (16 * get_turn()))
       & get_piece_bitboard(get_turn(), kKing);
   if (!danger) {
-    return GetMoves<Quiescent, static_cast<int>(MoveGenType::Fast)>();
+    GetMoves<Quiescent, static_cast<int>(MoveGenType::Fast)>(moves);
+    return moves;
   }
 
   danger = magic::GetAttackMap<kKnight>(king_square, 0) & get_piece_bitboard(get_not_turn(), kKnight);
@@ -1097,7 +1085,8 @@ std::vector<Move> Board::GetMoves() {
     danger |= (bitops::SE(king) | bitops::SW(king)) & enemy_pawns;
   }
   if (danger) {
-    return GetMoves<kNonQuiescent, static_cast<int>(MoveGenType::InCheck)>(danger);
+    GetMoves<kNonQuiescent, static_cast<int>(MoveGenType::InCheck)>(moves, danger);
+    return moves;
   }
 
   BitBoard own_pieces = color_bitboards[get_turn()];
@@ -1107,15 +1096,17 @@ std::vector<Move> Board::GetMoves() {
   danger |= magic::GetAttackMap<kRook>(king_square, all_pieces)
       & (get_piece_bitboard(get_not_turn(), kRook) | get_piece_bitboard(get_not_turn(), kQueen));
   if (danger) {
-    return GetMoves<kNonQuiescent, static_cast<int>(MoveGenType::InCheck)>(
-        magic::GetAttackMap<kRook>(king_square, all_pieces));
+    GetMoves<kNonQuiescent, static_cast<int>(MoveGenType::InCheck)>(
+        moves, magic::GetAttackMap<kRook>(king_square, all_pieces));
+    return moves;
   }
   danger |= magic::GetAttackMap<kBishop>(king_square, all_pieces)
       & (get_piece_bitboard(get_not_turn(), kBishop) | get_piece_bitboard(get_not_turn(), kQueen));
 
   if (danger) {
-    return GetMoves<kNonQuiescent, static_cast<int>(MoveGenType::InCheck)>(
-        magic::GetAttackMap<kBishop>(king_square, all_pieces));
+    GetMoves<kNonQuiescent, static_cast<int>(MoveGenType::InCheck)>(
+        moves, magic::GetAttackMap<kBishop>(king_square, all_pieces));
+    return moves;
   }
   BitBoard possibly_pinned = 0;
   const BitBoard rook_attacks = magic::GetAttackMap<kRook>(king_square, 0);
@@ -1128,11 +1119,12 @@ std::vector<Move> Board::GetMoves() {
                     | get_piece_bitboard(get_not_turn(), kQueen))) {
     possibly_pinned |= bishop_attacks & own_pieces;
   }
-  return GetMoves<Quiescent, static_cast<int>(MoveGenType::Normal)>(possibly_pinned);
+  GetMoves<Quiescent, static_cast<int>(MoveGenType::Normal)>(moves, possibly_pinned);
+  return moves;
 }
 
-template std::vector<Move> Board::GetMoves<kNonQuiescent>();
-template std::vector<Move> Board::GetMoves<kQuiescent>();
+template MoveList Board::GetMoves<kNonQuiescent>();
+template MoveList Board::GetMoves<kQuiescent>();
 
 bool Board::InCheck() const {
   Color not_color = get_not_turn();
@@ -1155,7 +1147,7 @@ bool Board::InCheck() const {
   return ptargeted | targeted;
 }
 
-bool Board::MoveInListCanRepeat(const std::vector<Move> moves) {
+bool Board::MoveInListCanRepeat(const MoveList &moves) {
   HashType mhash = get_hash() ^ hash::get_color_hash();
   std::vector<HashType> potential_hashes = std::vector<HashType>();
   potential_hashes.reserve(moves.size());
@@ -1175,12 +1167,12 @@ bool Board::MoveInListCanRepeat(const std::vector<Move> moves) {
   std::vector<HashType> pre_hashes = std::vector<HashType>();
   pre_hashes.reserve(fifty_move_count / 2);
 
-  int min_index = previous_hashes.size() - fifty_move_count;
+  int min_index = states.size() - fifty_move_count;
   if (min_index < 0) {
     min_index = 0;
   }
-  for (int index = previous_hashes.size()-1; index >= min_index; index -= 2) {
-    pre_hashes.emplace_back(previous_hashes[index]);
+  for (int index = states.size()-1; index >= min_index; index -= 2) {
+    pre_hashes.emplace_back(states[index].key);
   }
 
   std::sort(pre_hashes.begin(), pre_hashes.end());
@@ -1209,10 +1201,11 @@ bool Board::MoveInListCanRepeat(const std::vector<Move> moves) {
 
 int32_t Board::CountRepetitions(int32_t min_ply) const {
   int32_t repetitions = 1; //We count the current position as a "repetition"
-  int32_t min_index = std::max(static_cast<int32_t>(previous_hashes.size()) - fifty_move_count, min_ply);
+  int32_t min_index = std::max(static_cast<int32_t>(states.size()) - fifty_move_count,
+                               std::max(min_ply - static_cast<int32_t>(history_offset), 0));
   HashType cur_hash = get_hash();
-  for (int32_t index = previous_hashes.size()-2; index >= min_index; index-=2) {
-    repetitions += (cur_hash == previous_hashes[index]);
+  for (int32_t index = states.size()-2; index >= min_index; index-=2) {
+    repetitions += (cur_hash == states[index].key);
   }
   return repetitions;
 }
@@ -1318,22 +1311,81 @@ bool Board::NonNegativeSEE(const Move move) const {
 }
 
 bool Board::IsMoveLegal(const Move move) const {
-  assert(false); // Not yet properly implemented
+  // Castling and en passant are rare enough that callers can fall back to move
+  // generation, so they are never reported as legal here.
   if (move == kNullMove) {
     return false;
   }
-  Piece piece = get_piece(GetMoveSource(move));
-  if (GetPieceType(piece) == kNoPiece || GetPieceColor(piece) != get_turn()) {
+  const Square src = GetMoveSource(move);
+  const Square des = GetMoveDestination(move);
+  const MoveType move_type = GetMoveType(move);
+  const Piece piece = get_piece(src);
+  const PieceType piece_type = GetPieceType(piece);
+  if (piece_type == kNoPiece || GetPieceColor(piece) != get_turn()
+      || move_type == kCastle || move_type == kEnPassant || move_type > kQueenPromotion) {
     return false;
   }
-  switch (GetMoveType(move)) {
-    case kEnPassant:
-      if (!en_passant || en_passant != GetMoveDestination(move) || GetPieceType(piece) != kPawn) {
+  const BitBoard des_bb = GetSquareBitBoard(des);
+  if (des_bb & (get_color_bitboard(get_turn()) | get_piecetype_bitboard(kKing))) {
+    return false;
+  }
+
+  const bool is_capture = des_bb & get_color_bitboard(get_not_turn());
+  const BitBoard last_rank = get_turn() == kWhite ? bitops::eighth_rank : bitops::first_rank;
+  const bool promotes = piece_type == kPawn && (des_bb & last_rank);
+  if (promotes != (move_type >= kKnightPromotion)
+      || (move_type == kCapture && !is_capture)
+      || (move_type < kCapture && is_capture)
+      || (move_type == kDoublePawnMove && piece_type != kPawn)) {
+    return false;
+  }
+
+  const BitBoard all_pieces = get_all_pieces();
+  const BitBoard src_bb = GetSquareBitBoard(src);
+  if (piece_type == kPawn) {
+    const BitBoard push = get_turn() == kWhite ? bitops::N(src_bb) : bitops::S(src_bb);
+    if (is_capture) {
+      const BitBoard attacks = get_turn() == kWhite ? bitops::NE(src_bb) | bitops::NW(src_bb)
+                                                    : bitops::SE(src_bb) | bitops::SW(src_bb);
+      if (!(attacks & des_bb)) {
         return false;
       }
-      return true;
+    }
+    else if (move_type == kDoublePawnMove) {
+      const BitBoard second_rank = get_turn() == kWhite ? bitops::second_rank : bitops::seventh_rank;
+      const BitBoard double_push = get_turn() == kWhite ? bitops::N(push) : bitops::S(push);
+      if (!(src_bb & second_rank) || (push & all_pieces) || double_push != des_bb) {
+        return false;
+      }
+    }
+    else if (push != des_bb) {
+      return false;
+    }
+  }
+  else if (!(magic::GetAttackMap(piece_type, src, all_pieces) & des_bb)) {
+    return false;
+  }
+
+  // The move is pseudo legal, it remains to check that our king is safe afterwards.
+  const BitBoard occupancy = (all_pieces ^ src_bb) | des_bb;
+  const Square king = piece_type == kKing ? des
+      : bitops::NumberOfTrailingZeros(get_piece_bitboard(get_turn(), kKing));
+  const BitBoard king_bb = GetSquareBitBoard(king);
+  const Color not_turn = get_not_turn();
+  const BitBoard diagonal = get_piece_bitboard(not_turn, kBishop) | get_piece_bitboard(not_turn, kQueen);
+  const BitBoard straight = get_piece_bitboard(not_turn, kRook) | get_piece_bitboard(not_turn, kQueen);
+  BitBoard attackers = (magic::GetAttackMap<kKnight>(king, occupancy) & get_piece_bitboard(not_turn, kKnight))
+                     | (magic::GetAttackMap<kKing>(king, occupancy) & get_piece_bitboard(not_turn, kKing))
+                     | (magic::GetAttackMap<kBishop>(king, occupancy) & diagonal)
+                     | (magic::GetAttackMap<kRook>(king, occupancy) & straight);
+  if (get_turn() == kWhite) {
+    attackers |= (bitops::NE(king_bb) | bitops::NW(king_bb)) & get_piece_bitboard(not_turn, kPawn);
+  }
+  else {
+    attackers |= (bitops::SE(king_bb) | bitops::SW(king_bb)) & get_piece_bitboard(not_turn, kPawn);
   }
-  return true;
+  // A captured piece no longer attacks anything.
+  return !(attackers & ~des_bb);
 }
 
 std::array<BitBoard, 6> Board::GetDirectCheckingSquares() const {
@@ -28,6 +28,7 @@
 #define BOARD_H_
 
 #include "general/types.h"
+#include "general/move_list.h"
 #include "general/parse.h"
 #include "general/bit_operations.h"
 #include <array>
@@ -35,10 +36,40 @@
 #include <iostream>
 
 /**
- * This type is used to store information which is necessary in order to
- * implement the unmake move function such as ep.
+ * Pieces removed from and added to the board by a single move. This allows the
+ * network evaluation to be updated without comparing whole positions.
  */
-typedef int32_t MoveHistoryInformation;
+struct MoveDelta {
+  void Remove(const Piece piece, const Square square) {
+    removed[num_removed++] = {piece, square};
+  }
+  void Add(const Piece piece, const Square square) {
+    added[num_added++] = {piece, square};
+  }
+
+  std::array<std::pair<uint8_t, uint8_t>, 2> removed;
+  std::array<std::pair<uint8_t, uint8_t>, 2> added;
+  uint8_t num_removed = 0;
+  uint8_t num_added = 0;
+};
+
+/**
+ * Everything needed to take back a move, saved by Make. The position before the
+ * move is restored from here instead of being recomputed.
+ */
+struct StateInfo {
+  HashType key; // get_hash() before the move, compared to detect repetitions
+  HashType hash;
+  HashType pawn_hash;
+  HashType major_hash;
+  std::array<HashType, kNumRngHash> rng_hash;
+  MoveDelta delta;
+  Move move;
+  uint16_t fifty_move_count;
+  uint8_t castling_rights;
+  uint8_t en_passant;
+  uint8_t captured;
+};
 
 class Board {
 public:
@@ -50,7 +81,7 @@ public:
   void SetBoard(std::vector<std::string> fen_tokens);
   void evaluate_castling_rights(std::string fen_code);
   template<int Quiescent>
-  std::vector<Move> GetMoves();
+  MoveList GetMoves();
   void Make(const Move move);
   void UnMake();
   void SetStartBoard();
@@ -86,7 +117,7 @@ public:
   int8_t get_num_pieces() const {
     return bitops::PopCount(color_bitboards[kWhite] | color_bitboards[kBlack]);
   }
-  size_t get_num_made_moves() const { return move_history.size(); }
+  size_t get_num_made_moves() const { return history_offset + states.size(); }
   int32_t get_piece_count(const Color color, const PieceType piece_type) const {
     return piece_counts[color][piece_type];
   }
@@ -112,8 +143,8 @@ public:
     parse::PrintBitboard(color_bitboards[kBlack]);
   }
   void PrintMadeMoves() const {
-    for (size_t i = 0; i < move_history.size(); i++) {
-      std::cout << parse::MoveToString(move_history[i]) << " ";
+    for (const StateInfo &state : states) {
+      std::cout << parse::MoveToString(state.move) << " ";
     }
     std::cout << std::endl;
   }
@@ -126,17 +157,29 @@ public:
   bool NonNegativeSEESquare(const Square target) const;
 
   Board copy() const;
-  Move get_last_move() const { return move_history.back(); }
+  Move get_last_move() const { return states.back().move; }
+  // Delta of the move played the given number of plies ago, starting at 1.
+  const MoveDelta& get_move_delta(size_t plies_ago) const {
+    return states[states.size() - plies_ago].delta;
+  }
+  // Hash of the position the given number of plies ago, starting at 1.
+  HashType get_previous_hash(size_t plies_ago) const {
+    return states[states.size() - plies_ago].key;
+  }
   BitBoard PlayerBitBoardControl(Color color, BitBoard all_pieces) const;
-  bool MoveInListCanRepeat(const std::vector<Move> moves);
+  bool MoveInListCanRepeat(const MoveList &moves);
   int32_t CountRepetitions(int32_t min_ply = 0) const;
 
 private:
   template<int Quiescent, int MoveGenerationType>
-  std::vector<Move> GetMoves(BitBoard critical = 0);
+  void GetMoves(MoveList &legal_moves, BitBoard critical = 0);
   void SwapTurn();
+  // UnMake restores the hashes from the saved state and skips updating them.
+  template<bool update_hashes = true>
   void AddPiece(const Square square, const Piece piece);
+  template<bool update_hashes = true>
   Piece RemovePiece(const Square square);
+  template<bool update_hashes = true>
   Piece MovePiece(const Square source, const Square destination);
   template<int piece_type>
   PieceType next_see_attacker(const Color color, const Square target,
@@ -145,11 +188,11 @@ private:
   BitBoard pt_bitboards[kNumPieceTypes - 1];
   BitBoard color_bitboards[kNumPlayers];
   int8_t piece_counts[kNumPlayers][kNumPieceTypes - 1];
-  Piece pieces[kBoardLength*kBoardLength];
-  std::vector<Move> move_history;
-  std::vector<HashType> previous_hashes;
-  //Includes information necessary to restore a previous state.
-  std::vector<MoveHistoryInformation> move_history_information;
+  uint8_t pieces[kBoardLength*kBoardLength];
+  // One entry per made move. Search boards only hold the moves which matter for
+  // repetitions, history_offset counts the moves left out before them.
+  std::vector<StateInfo> states;
+  size_t history_offset;
   //4 bits are set representing white and black, queen- and kingside castling
   CastlingRights castling_rights;
   Square en_passant;
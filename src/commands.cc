@@ -1,11 +1,14 @@
 #include "benchmark.h"
 #include "board.h"
 #include "commands.h"
+#include "data.h"
 #include "net_evaluation.h"
 #include "search.h"
+#include "transposition.h"
 
 #include <vector>
 #include <string>
+#include <fstream>
 
 namespace commands {
 
@@ -14,14 +17,14 @@ void PrintBoard(Board &board, const StrArgs) {
 }
 
 void PrintMoves(Board &board, const StrArgs) {
-  std::vector<Move> moves = board.GetMoves<kNonQuiescent>();
+  MoveList moves = board.GetMoves<kNonQuiescent>();
   for (unsigned int i = 0; i < moves.size(); i++) {
     std::cout << parse::MoveToString(moves[i]) << std::endl;
   }
 }
 
 void PrintMovesSorted(Board &board, const StrArgs) {
-  std::vector<Move> moves = search::GetSortedMovesML(board);
+  MoveList moves = search::GetSortedMovesML(board);
   for (unsigned int i = 0; i < moves.size(); i++) {
     std::cout << parse::MoveToString(moves[i]) << std::endl;
   }
@@ -39,6 +42,14 @@ void SymmetryTest(Board &board, const StrArgs) {
   benchmark::SymmetrySuite();
 }
 
+void QuantizationTest(Board &board, const StrArgs) {
+  benchmark::QuantizationSuite();
+}
+
+void EvalBench(Board &board, const StrArgs) {
+  benchmark::EvalBench();
+}
+
 void SEE(Board &board, const StrArgs tokens) {
   Move move = parse::StringToMove(tokens[1]);
   std::cout << board.NonNegativeSEE(move) << std::endl;
@@ -47,7 +58,7 @@ void SEE(Board &board, const StrArgs tokens) {
 void Perft(Board &board, const StrArgs tokens) {
   int index = 1;
   Depth depth = atoi(tokens[index++].c_str());
-  std::vector<Move> moves = board.GetMoves<kNonQuiescent>();
+  MoveList moves = board.GetMoves<kNonQuiescent>();
   uint64_t sum = 0;
   Time begin = now();
   for (Move move : moves) {
@@ -74,7 +85,7 @@ void GetFEN(Board &board, const StrArgs) {
 }
 
 void CheckIfRepetitionPossible(Board &board, const StrArgs) {
-  std::vector<Move> moves = board.GetMoves<kNonQuiescent>();
+  MoveList moves = board.GetMoves<kNonQuiescent>();
   if (board.MoveInListCanRepeat(moves)) {
     std::cout << "yes" << std::endl;
   }
@@ -91,4 +102,56 @@ void EvaluateBoard(Board &board, const StrArgs) {
   std::cout << net_evaluation::ScoreBoard(board).to_wpct() << std::endl;
 }
 
+void EvaluateFile(Board &board, const StrArgs tokens) {
+  if (tokens.size() < 3) {
+    std::cout << "usage: evaluate_file <in.fen> <out.csv>" << std::endl;
+    return;
+  }
+  std::vector<Board> boards = data::LoadBoardFens(tokens[1]);
+  Time begin = now();
+  std::vector<Score> scores = net_evaluation::ScoreBoards(boards);
+  Time end = now();
+  auto time_used = std::chrono::duration_cast<Milliseconds>(end-begin);
+  std::cout << "evaluated " << boards.size() << " positions in " << time_used.count()
+      << "ms (" << ((1000 * boards.size()) / (time_used.count() + 1)) << " evals/s)" << std::endl;
+
+  std::ofstream file(tokens[2]);
+  file << "fen,win,draw,loss" << std::endl;
+  for (size_t i = 0; i < boards.size(); ++i) {
+    std::vector<std::string> fen = boards[i].GetFen();
+    for (size_t j = 0; j < fen.size(); ++j) {
+      file << (j == 0 ? "" : " ") << fen[j];
+    }
+    const auto [win, draw, loss] = scores[i].get_wdl_probabilities();
+    file << "," << win << "," << draw << "," << loss << "\n";
+  }
+  file.close();
+}
+
+void SaveHash(Board &board, const StrArgs tokens) {
+  if (tokens.size() < 2) {
+    std::cout << "usage: save_hash <file>" << std::endl;
+    return;
+  }
+  if (table::SaveTable(tokens[1])) {
+    std::cout << "info string saved hash to " << tokens[1] << std::endl;
+  }
+  else {
+    std::cout << "info string failed to save hash to " << tokens[1] << std::endl;
+  }
+}
+
+void LoadHash(Board &board, const StrArgs tokens) {
+  if (tokens.size() < 2) {
+    std::cout << "usage: load_hash <file>" << std::endl;
+    return;
+  }
+  if (table::LoadTable(tokens[1])) {
+    std::cout << "info string loaded hash from " << tokens[1] << std::endl;
+  }
+  else {
+    std::cout << "info string failed to load hash from " << tokens[1] << std::endl;
+  }
+}
+
 }
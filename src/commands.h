@@ -21,12 +21,17 @@ void PrintMovesSorted(Board &board, const StrArgs);
 void CheckIfDraw(Board &board, const StrArgs);
 void PerftTest(Board &board, const StrArgs);
 void SymmetryTest(Board &board, const StrArgs);
+void QuantizationTest(Board &board, const StrArgs);
+void EvalBench(Board &board, const StrArgs);
 void SEE(Board &board, const StrArgs tokens);
 void Perft(Board &board, const StrArgs tokens);
 void GetFEN(Board &board, const StrArgs);
 void CheckIfRepetitionPossible(Board &board, const StrArgs);
 void PrintBitboards(Board &board, const StrArgs);
 void EvaluateBoard(Board &board, const StrArgs);
+void EvaluateFile(Board &board, const StrArgs tokens);
+void SaveHash(Board &board, const StrArgs tokens);
+void LoadHash(Board &board, const StrArgs tokens);
 
 }
 
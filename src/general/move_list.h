@@ -0,0 +1,94 @@
+/*
+ *  Winter is a UCI chess engine.
+ *
+ *  Copyright (C) 2016 Jonas Kuratli, Jonathan Maurer, Jonathan Rosenthal
+ *  Copyright (C) 2017-2018 Jonathan Rosenthal
+ *
+ *  Winter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Winter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * move_list.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonathan Rosenthal
+ */
+
+#ifndef SRC_GENERAL_MOVE_LIST_H_
+#define SRC_GENERAL_MOVE_LIST_H_
+
+#include "types.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+
+// No legal chess position has more than 218 moves, pseudo legal move lists
+// included.
+constexpr size_t kMaxMoves = 256;
+
+// A move list with inline storage, so move generation and search never touch
+// the heap. Every move has a score slot used for move ordering.
+class MoveList {
+ public:
+  MoveList() = default;
+  MoveList(const MoveList &other) { *this = other; }
+  MoveList &operator=(const MoveList &other) {
+    num_moves = other.num_moves;
+    std::copy(other.begin(), other.end(), begin());
+    std::copy(other.scores.begin(), other.scores.begin() + num_moves, scores.begin());
+    return *this;
+  }
+
+  size_t size() const { return num_moves; }
+  bool empty() const { return num_moves == 0; }
+  void clear() { num_moves = 0; }
+
+  void emplace_back(const Move move) {
+    assert(num_moves < kMaxMoves);
+    scores[num_moves] = 0;
+    moves[num_moves++] = move;
+  }
+
+  Move &operator[](const size_t idx) { return moves[idx]; }
+  Move operator[](const size_t idx) const { return moves[idx]; }
+  MoveScore &score(const size_t idx) { return scores[idx]; }
+  MoveScore score(const size_t idx) const { return scores[idx]; }
+
+  Move *begin() { return moves.data(); }
+  Move *end() { return moves.data() + num_moves; }
+  const Move *begin() const { return moves.data(); }
+  const Move *end() const { return moves.data() + num_moves; }
+
+  // Removes the moves in [first, last) along with their scores.
+  Move *erase(Move *first, Move *last) {
+    const size_t first_idx = first - begin(), last_idx = last - begin();
+    std::copy(scores.begin() + last_idx, scores.begin() + num_moves, scores.begin() + first_idx);
+    std::copy(last, end(), first);
+    num_moves -= last_idx - first_idx;
+    return first;
+  }
+
+  // Swaps two moves along with their scores.
+  void swap(const size_t a, const size_t b) {
+    std::swap(moves[a], moves[b]);
+    std::swap(scores[a], scores[b]);
+  }
+
+ private:
+  size_t num_moves = 0;
+  std::array<Move, kMaxMoves> moves;
+  std::array<MoveScore, kMaxMoves> scores;
+};
+
+#endif /* SRC_GENERAL_MOVE_LIST_H_ */
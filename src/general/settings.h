@@ -37,8 +37,16 @@ const std::string engine_version = "5.02";
 
 const std::string engine_author = "Jonathan Rosenthal";
 
-#if defined(__BMI2__)
+#if defined(__AVX512VNNI__) && defined(__AVX512BW__)
+const std::string compile_arch = "AVX512-VNNI";
+#elif defined(__AVX512BW__)
+const std::string compile_arch = "AVX512";
+#elif defined(__AVXVNNI__)
+const std::string compile_arch = "AVX-VNNI";
+#elif defined(__BMI2__)
 const std::string compile_arch = "BMI2";
+#elif defined(__AVX2__)
+const std::string compile_arch = "AVX2";
 #elif defined(__AVX__)
 const std::string compile_arch = "AVX";
 #elif defined(__SSE4_2__)
@@ -53,6 +61,7 @@ constexpr bool kUseExtensions = true;
 constexpr bool kUseScoreBasedPruning = true;
 constexpr Depth kRepsForDraw = 2;
 constexpr Depth kMaxDepth = 128;
+constexpr int32_t kDefaultEvalCacheMB = 2;
 
 constexpr bool kUseQS = true;
 
@@ -39,10 +39,11 @@ using BitBoard = uint64_t;
 // A square is defined by its index
 using Square = int32_t;
 // A move references a source, a destination square and a move type, but no piece.
-using Move = int32_t;
+// Move ordering scores are kept separately, so 16 bits suffice.
+using Move = uint16_t;
 // A movetype references whether a move is a normal move or a special move
 // such as a pawn promotion or castling.
-using MoveType = Move;
+using MoveType = int32_t;
 // MoveScore is used to order moves.
 using MoveScore = int32_t;
 // A piece is an object with a PieceType and Color
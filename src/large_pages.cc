@@ -0,0 +1,167 @@
+/*
+ *  Winter is a UCI chess engine.
+ *
+ *  Copyright (C) 2016 Jonas Kuratli, Jonathan Maurer, Jonathan Rosenthal
+ *  Copyright (C) 2017-2018 Jonathan Rosenthal
+ *
+ *  Winter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Winter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * large_pages.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonathan Rosenthal
+ */
+
+#include "large_pages.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#if defined(__linux__)
+  #include <sys/mman.h>
+  #include <linux/mman.h>     // for MAP_HUGE_2MB/MAP_HUGE_1GB
+#elif defined(_WIN32)
+  #include <malloc.h>         // for _aligned_malloc
+#endif
+
+namespace {
+
+constexpr size_t k2MB = size_t(1) << 21;
+constexpr size_t k1GB = size_t(1) << 30;
+
+size_t RoundUp(const size_t bytes, const size_t alignment) {
+  return ((bytes + alignment - 1) / alignment) * alignment;
+}
+
+#if defined(__linux__)
+void* MapHuge(const size_t bytes, const int page_flag) {
+  void *ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | page_flag, -1, 0);
+  return ptr == MAP_FAILED ? nullptr : ptr;
+}
+
+// Maps memory aligned to 2MB by trimming an oversized mapping, so transparent
+// huge pages can back the whole range.
+void* MapAligned(const size_t bytes) {
+  void *raw = mmap(nullptr, bytes + k2MB, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (raw == MAP_FAILED) {
+    return nullptr;
+  }
+  const size_t start = reinterpret_cast<size_t>(raw);
+  const size_t aligned = RoundUp(start, k2MB);
+  if (aligned > start) {
+    munmap(raw, aligned - start);
+  }
+  const size_t tail = (start + bytes + k2MB) - (aligned + bytes);
+  if (tail > 0) {
+    munmap(reinterpret_cast<void*>(aligned + bytes), tail);
+  }
+  return reinterpret_cast<void*>(aligned);
+}
+
+bool TransparentHugePagesEnabled() {
+  std::ifstream file("/sys/kernel/mm/transparent_hugepage/enabled");
+  std::string setting;
+  std::getline(file, setting);
+  return setting.find("[never]") == std::string::npos;
+}
+#endif
+
+}
+
+namespace large_pages {
+
+Allocation Allocate(const size_t bytes) {
+  Allocation allocation;
+#if defined(__linux__)
+#if defined(MAP_HUGE_1GB)
+  // Rounding up to whole 1GB pages could waste most of a page from the small
+  // reserved pool, so other sizes go straight to 2MB pages.
+  if (bytes >= k1GB && bytes % k1GB == 0) {
+    allocation.bytes = bytes;
+    allocation.ptr = MapHuge(allocation.bytes, MAP_HUGE_1GB);
+    if (allocation.ptr) {
+      allocation.page_type = PageType::kHuge1GB;
+      return allocation;
+    }
+  }
+#endif
+#if defined(MAP_HUGE_2MB)
+  allocation.bytes = RoundUp(bytes, k2MB);
+  allocation.ptr = MapHuge(allocation.bytes, MAP_HUGE_2MB);
+  if (allocation.ptr) {
+    allocation.page_type = PageType::kHuge2MB;
+    return allocation;
+  }
+#endif
+  allocation.bytes = RoundUp(bytes, k2MB);
+  allocation.ptr = MapAligned(allocation.bytes);
+  if (allocation.ptr) {
+    allocation.page_type = PageType::kNormal;
+#if defined(MADV_HUGEPAGE)
+    if (TransparentHugePagesEnabled()
+        && madvise(allocation.ptr, allocation.bytes, MADV_HUGEPAGE) == 0) {
+      allocation.page_type = PageType::kTransparent;
+    }
+#endif
+    return allocation;
+  }
+#else
+  allocation.bytes = RoundUp(bytes, 4096);
+#if defined(_WIN32)
+  allocation.ptr = _aligned_malloc(allocation.bytes, 4096);
+#else
+  allocation.ptr = std::aligned_alloc(4096, allocation.bytes);
+#endif
+  if (allocation.ptr) {
+    std::memset(allocation.ptr, 0, allocation.bytes);
+    allocation.page_type = PageType::kNormal;
+    return allocation;
+  }
+#endif
+  std::cerr << "Failed to allocate " << bytes << " bytes!" << std::endl;
+  exit(EXIT_FAILURE);
+}
+
+void Free(Allocation &allocation) {
+  if (!allocation.ptr) {
+    return;
+  }
+#if defined(__linux__)
+  munmap(allocation.ptr, allocation.bytes);
+#elif defined(_WIN32)
+  _aligned_free(allocation.ptr);
+#else
+  std::free(allocation.ptr);
+#endif
+  allocation = Allocation();
+}
+
+std::string PageTypeName(const PageType page_type) {
+  switch (page_type) {
+  case PageType::kHuge1GB:
+    return "1GB huge pages";
+  case PageType::kHuge2MB:
+    return "2MB huge pages";
+  case PageType::kTransparent:
+    return "transparent huge pages";
+  default:
+    return "normal pages";
+  }
+}
+
+}
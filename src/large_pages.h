@@ -0,0 +1,59 @@
+/*
+ *  Winter is a UCI chess engine.
+ *
+ *  Copyright (C) 2016 Jonas Kuratli, Jonathan Maurer, Jonathan Rosenthal
+ *  Copyright (C) 2017-2018 Jonathan Rosenthal
+ *
+ *  Winter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Winter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * large_pages.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonathan Rosenthal
+ */
+
+#ifndef LARGE_PAGES_H_
+#define LARGE_PAGES_H_
+
+#include <cstddef>
+#include <string>
+
+// Allocation of large, zero initialized buffers directly from the OS. Explicit
+// huge pages are preferred, as large tables are otherwise dominated by TLB misses.
+namespace large_pages {
+
+enum class PageType {
+  kHuge1GB,     // MAP_HUGETLB with 1GB pages
+  kHuge2MB,     // MAP_HUGETLB with 2MB pages
+  kTransparent, // Regular mapping with transparent huge pages requested
+  kNormal
+};
+
+struct Allocation {
+  void *ptr = nullptr;
+  size_t bytes = 0;
+  PageType page_type = PageType::kNormal;
+};
+
+// Tries 1GB pages for multiples of 1GB and 2MB huge pages, then transparent huge
+// pages and finally normal pages. Exits if no memory could be allocated at all.
+Allocation Allocate(const size_t bytes);
+void Free(Allocation &allocation);
+
+std::string PageTypeName(const PageType page_type);
+
+}
+
+#endif /* LARGE_PAGES_H_ */
@@ -0,0 +1,563 @@
+/*
+ *  Winter is a UCI chess engine.
+ *
+ *  Copyright (C) 2016 Jonas Kuratli, Jonathan Maurer, Jonathan Rosenthal
+ *  Copyright (C) 2017-2019 Jonathan Rosenthal
+ *
+ *  Winter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Winter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * linear_algebra_impl.h
+ *
+ *  Created on: Mar 17, 2017
+ *      Author: Jonathan Rosenthal
+ */
+
+// SIMD vector types for a single backend. This file deliberately has no include
+// guard. linear_algebra.h includes it with the features of the compiler flags,
+// while net_evaluation.cc includes it once per backend in builds with runtime
+// dispatch. The backend is selected by the following macros:
+// SIMD_AVX, SIMD_AVX2, SIMD_FMA, SIMD_AVX512 (F and BW), SIMD_AVX512VL,
+// SIMD_AVX512VNNI and SIMD_AVXVNNI.
+
+template <typename type, size_t length>
+struct Vec;
+
+#if defined(SIMD_AVX512)
+using SIMDFloat = __m512;
+constexpr size_t kSIMDWidth = 16;
+
+namespace simd {
+
+inline float sum(SIMDFloat x) { return _mm512_reduce_add_ps(x); }
+
+inline SIMDFloat add(const SIMDFloat a, const SIMDFloat b) { return _mm512_add_ps(a, b); }
+inline SIMDFloat sub(const SIMDFloat a, const SIMDFloat b) { return _mm512_sub_ps(a, b); }
+inline SIMDFloat multiply(const SIMDFloat a, const SIMDFloat b) { return _mm512_mul_ps(a, b); }
+inline void store(float* mem_addr, SIMDFloat a) { _mm512_store_ps(mem_addr, a); }
+inline SIMDFloat load(float const* mem_addr) { return _mm512_load_ps(mem_addr); }
+inline SIMDFloat max(SIMDFloat a, SIMDFloat b) { return _mm512_max_ps(a,  b); }
+inline SIMDFloat min(SIMDFloat a, SIMDFloat b) { return _mm512_min_ps(a,  b); }
+inline SIMDFloat set(float a) { return _mm512_set1_ps(a); }
+inline SIMDFloat fmadd(SIMDFloat a, SIMDFloat b, SIMDFloat c) { return _mm512_fmadd_ps(a, b, c); }
+
+}
+
+#elif defined(SIMD_AVX)
+using SIMDFloat = __m256;
+constexpr size_t kSIMDWidth = 8;
+
+namespace simd {
+
+// Sept. 10, 2020. Taken from: https://stackoverflow.com/questions/13219146/how-to-sum-m256-horizontally
+inline float sum(__m256 x) {
+    const __m128 hiQuad = _mm256_extractf128_ps(x, 1);
+    const __m128 loQuad = _mm256_castps256_ps128(x);
+    const __m128 sumQuad = _mm_add_ps(loQuad, hiQuad);
+    const __m128 loDual = sumQuad;
+    const __m128 hiDual = _mm_movehl_ps(sumQuad, sumQuad);
+    const __m128 sumDual = _mm_add_ps(loDual, hiDual);
+    const __m128 lo = sumDual;
+    const __m128 hi = _mm_shuffle_ps(sumDual, sumDual, 0x1);
+    const __m128 sum = _mm_add_ss(lo, hi);
+    return _mm_cvtss_f32(sum);
+}
+
+inline SIMDFloat add(const SIMDFloat a, const SIMDFloat b) { return _mm256_add_ps(a, b); }
+inline SIMDFloat sub(const SIMDFloat a, const SIMDFloat b) { return _mm256_sub_ps(a, b); }
+inline SIMDFloat multiply(const SIMDFloat a, const SIMDFloat b) { return _mm256_mul_ps(a, b); }
+inline void store(float* mem_addr, SIMDFloat a) { _mm256_store_ps(mem_addr, a); }
+inline SIMDFloat load(float const* mem_addr) { return _mm256_load_ps(mem_addr); }
+inline SIMDFloat max(SIMDFloat a, SIMDFloat b) { return _mm256_max_ps(a,  b); }
+inline SIMDFloat min(SIMDFloat a, SIMDFloat b) { return _mm256_min_ps(a,  b); }
+inline SIMDFloat set(float a) { return _mm256_set1_ps(a); }
+
+inline SIMDFloat fmadd(SIMDFloat a, SIMDFloat b, SIMDFloat c) {
+#ifdef SIMD_FMA
+  return _mm256_fmadd_ps(a, b, c);
+#else
+  return add(multiply(a, b), c);
+#endif
+}
+
+}
+
+#else
+using SIMDFloat = __m128;
+constexpr size_t kSIMDWidth = 4;
+
+namespace simd {
+// Sept. 10, 2020. Taken from: https://stackoverflow.com/questions/6996764/fastest-way-to-do-horizontal-sse-vector-sum-or-other-reduction
+inline float sum(SIMDFloat v) {                                 
+  SIMDFloat shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+  SIMDFloat sums = _mm_add_ps(v, shuf);
+  shuf = _mm_movehl_ps(shuf, sums);
+  sums = _mm_add_ss(sums, shuf);
+  return _mm_cvtss_f32(sums);
+}
+
+inline SIMDFloat add(const SIMDFloat a, const SIMDFloat b) { return _mm_add_ps(a, b); }
+inline SIMDFloat sub(const SIMDFloat a, const SIMDFloat b) { return _mm_sub_ps(a, b); }
+inline SIMDFloat multiply(const SIMDFloat a, const SIMDFloat b) { return _mm_mul_ps(a, b); }
+inline void store(float* mem_addr, SIMDFloat a) { _mm_store_ps(mem_addr, a); }
+inline SIMDFloat load(float const* mem_addr) { return _mm_load_ps(mem_addr); }
+inline SIMDFloat max(SIMDFloat a, SIMDFloat b) { return _mm_max_ps(a,  b); }
+inline SIMDFloat min(SIMDFloat a, SIMDFloat b) { return _mm_min_ps(a,  b); }
+inline SIMDFloat set(float a) { return _mm_set1_ps(a); }
+
+inline SIMDFloat fmadd(SIMDFloat a, SIMDFloat b, SIMDFloat c) {
+#ifdef SIMD_FMA
+  return _mm_fmadd_ps(a, b, c);
+#else
+  return add(multiply(a, b), c);
+#endif
+}
+
+}
+#endif
+
+// Integer SIMD wrappers used by the quantized network path.
+#if defined(SIMD_AVX512)
+using SIMDInt = __m512i;
+
+namespace simd {
+
+inline SIMDInt load_int(const void* mem_addr) { return _mm512_load_si512(mem_addr); }
+inline void store_int(void* mem_addr, SIMDInt a) { _mm512_store_si512(mem_addr, a); }
+inline SIMDInt add_epi16(SIMDInt a, SIMDInt b) { return _mm512_add_epi16(a, b); }
+inline SIMDInt sub_epi16(SIMDInt a, SIMDInt b) { return _mm512_sub_epi16(a, b); }
+inline SIMDInt max_epi16(SIMDInt a, SIMDInt b) { return _mm512_max_epi16(a, b); }
+inline SIMDInt min_epi16(SIMDInt a, SIMDInt b) { return _mm512_min_epi16(a, b); }
+inline SIMDInt srai_epi16(SIMDInt a, int shift) { return _mm512_srai_epi16(a, shift); }
+inline SIMDInt set_epi16(int16_t a) { return _mm512_set1_epi16(a); }
+inline SIMDInt add_epi32(SIMDInt a, SIMDInt b) { return _mm512_add_epi32(a, b); }
+inline SIMDInt set_epi32(int32_t a) { return _mm512_set1_epi32(a); }
+// Multiplies 16 bit lanes and adds adjacent pairs of products into 32 bit lanes.
+inline SIMDInt madd_epi16(SIMDInt a, SIMDInt b) { return _mm512_madd_epi16(a, b); }
+// Equivalent to add_epi32(c, madd_epi16(a, b)), fused into one instruction with VNNI.
+inline SIMDInt dpwssd_epi32(SIMDInt c, SIMDInt a, SIMDInt b) {
+#ifdef SIMD_AVX512VNNI
+  return _mm512_dpwssd_epi32(c, a, b);
+#else
+  return add_epi32(c, madd_epi16(a, b));
+#endif
+}
+
+inline int32_t sum_epi32(SIMDInt x) { return _mm512_reduce_add_epi32(x); }
+
+}
+
+#elif defined(SIMD_AVX2)
+using SIMDInt = __m256i;
+
+namespace simd {
+
+inline SIMDInt load_int(const void* mem_addr) { return _mm256_load_si256(static_cast<const SIMDInt*>(mem_addr)); }
+inline void store_int(void* mem_addr, SIMDInt a) { _mm256_store_si256(static_cast<SIMDInt*>(mem_addr), a); }
+inline SIMDInt add_epi16(SIMDInt a, SIMDInt b) { return _mm256_add_epi16(a, b); }
+inline SIMDInt sub_epi16(SIMDInt a, SIMDInt b) { return _mm256_sub_epi16(a, b); }
+inline SIMDInt max_epi16(SIMDInt a, SIMDInt b) { return _mm256_max_epi16(a, b); }
+inline SIMDInt min_epi16(SIMDInt a, SIMDInt b) { return _mm256_min_epi16(a, b); }
+inline SIMDInt srai_epi16(SIMDInt a, int shift) { return _mm256_srai_epi16(a, shift); }
+inline SIMDInt set_epi16(int16_t a) { return _mm256_set1_epi16(a); }
+inline SIMDInt add_epi32(SIMDInt a, SIMDInt b) { return _mm256_add_epi32(a, b); }
+inline SIMDInt set_epi32(int32_t a) { return _mm256_set1_epi32(a); }
+// Multiplies 16 bit lanes and adds adjacent pairs of products into 32 bit lanes.
+inline SIMDInt madd_epi16(SIMDInt a, SIMDInt b) { return _mm256_madd_epi16(a, b); }
+// Equivalent to add_epi32(c, madd_epi16(a, b)), fused into one instruction with VNNI.
+inline SIMDInt dpwssd_epi32(SIMDInt c, SIMDInt a, SIMDInt b) {
+#if defined(SIMD_AVX512VNNI) && defined(SIMD_AVX512VL)
+  return _mm256_dpwssd_epi32(c, a, b);
+#elif defined(SIMD_AVXVNNI)
+  return _mm256_dpwssd_avx_epi32(c, a, b);
+#else
+  return add_epi32(c, madd_epi16(a, b));
+#endif
+}
+
+inline int32_t sum_epi32(SIMDInt x) {
+  __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(sum);
+}
+
+}
+
+#else
+using SIMDInt = __m128i;
+
+namespace simd {
+
+inline SIMDInt load_int(const void* mem_addr) { return _mm_load_si128(static_cast<const SIMDInt*>(mem_addr)); }
+inline void store_int(void* mem_addr, SIMDInt a) { _mm_store_si128(static_cast<SIMDInt*>(mem_addr), a); }
+inline SIMDInt add_epi16(SIMDInt a, SIMDInt b) { return _mm_add_epi16(a, b); }
+inline SIMDInt sub_epi16(SIMDInt a, SIMDInt b) { return _mm_sub_epi16(a, b); }
+inline SIMDInt max_epi16(SIMDInt a, SIMDInt b) { return _mm_max_epi16(a, b); }
+inline SIMDInt min_epi16(SIMDInt a, SIMDInt b) { return _mm_min_epi16(a, b); }
+inline SIMDInt srai_epi16(SIMDInt a, int shift) { return _mm_srai_epi16(a, shift); }
+inline SIMDInt set_epi16(int16_t a) { return _mm_set1_epi16(a); }
+inline SIMDInt add_epi32(SIMDInt a, SIMDInt b) { return _mm_add_epi32(a, b); }
+inline SIMDInt set_epi32(int32_t a) { return _mm_set1_epi32(a); }
+// Multiplies 16 bit lanes and adds adjacent pairs of products into 32 bit lanes.
+inline SIMDInt madd_epi16(SIMDInt a, SIMDInt b) { return _mm_madd_epi16(a, b); }
+inline SIMDInt dpwssd_epi32(SIMDInt c, SIMDInt a, SIMDInt b) { return add_epi32(c, madd_epi16(a, b)); }
+
+inline int32_t sum_epi32(SIMDInt x) {
+  SIMDInt sum = _mm_add_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2)));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(sum);
+}
+
+}
+#endif
+
+#if defined(SIMD_DISPATCH)
+// Vectors are shared between all backends of a dispatching build, so their layout
+// may not depend on the backend.
+constexpr size_t kFloatVecAlignment = 64;
+constexpr size_t kIntVecAlignment = 64;
+#else
+constexpr size_t kFloatVecAlignment = sizeof(SIMDFloat);
+constexpr size_t kIntVecAlignment = sizeof(SIMDInt);
+#endif
+
+constexpr size_t kSIMDInt16Width = sizeof(SIMDInt) / sizeof(int16_t);
+constexpr size_t kSIMDInt32Width = sizeof(SIMDInt) / sizeof(int32_t);
+
+template<size_t length>
+struct Vec<float, length> {
+  Vec() {}
+  
+  Vec(float val) {
+    for (size_t i = 0; i < length; ++i) {
+      values[i] = val;
+    }
+  }
+  
+  inline size_t size() const {
+    return length;
+  }
+  
+  float sum() const {
+    SIMDFloat acc = simd::set(0.0f);
+    size_t i = 0;
+    for (; i <= length-kSIMDWidth; i+=kSIMDWidth) {
+      SIMDFloat v = simd::load(&values[i]);
+      acc = simd::add(acc, v);
+    }
+    float total = simd::sum(acc); // Horizontal sum of accumulator
+    return total;
+  }
+  
+  inline Vec<float, length>& operator+=(const Vec<float, length> &rhs) {
+    #pragma GCC unroll 32
+    for (size_t i = 0; i <= length-kSIMDWidth; i+=kSIMDWidth) {
+      SIMDFloat v1 = simd::load(&values[i]);
+      SIMDFloat v2 = simd::load(&rhs.values[i]);
+      simd::store(&values[i], simd::add(v1, v2));
+    }
+    return *this;
+  }
+  
+  inline Vec<float, length>& operator-=(const Vec<float, length> &rhs) {
+    #pragma GCC unroll 32
+    for (size_t i = 0; i <= length-kSIMDWidth; i+=kSIMDWidth) {
+      SIMDFloat v1 = simd::load(&values[i]);
+      SIMDFloat v2 = simd::load(&rhs.values[i]);
+      simd::store(&values[i], simd::sub(v1, v2));
+    }
+    return *this;
+  }
+  
+  inline Vec<float, length>& operator*=(const Vec<float, length> &rhs) {
+    for (size_t i = 0; i <= length-kSIMDWidth; i+=kSIMDWidth) {
+      SIMDFloat v1 = simd::load(&values[i]);
+      SIMDFloat v2 = simd::load(&rhs.values[i]);
+      simd::store(&values[i], simd::multiply(v1, v2));
+    }
+    return *this;
+  }
+  
+  inline Vec<float, length>& relu() {
+    const SIMDFloat zero = simd::set(0);
+    for (size_t i = 0; i <= length-kSIMDWidth; i += kSIMDWidth) {
+      SIMDFloat v1 = simd::load(&values[i]);
+      simd::store(&values[i], simd::max(v1, zero));
+    }
+    return *this;
+  }
+  
+  [[nodiscard]] inline Vec<float, length> clipped_relu(const float max_val) const {
+    const SIMDFloat zero = simd::set(0);
+    const SIMDFloat max_simd = simd::set(max_val);
+    Vec<float, length> result;
+    #pragma GCC unroll 32
+    for (size_t i = 0; i <= length-kSIMDWidth; i += kSIMDWidth) {
+      SIMDFloat v1 = simd::load(&values[i]);
+      simd::store(&result.values[i], simd::min(simd::max(v1, zero), max_simd));
+    }
+    return result;
+  }
+  
+  inline Vec<float, length>& FMA(const Vec<float, length> &a, const float &b) {
+    static_assert(length == 8 * (length / 8), "Input length is not multiple of 16");
+    SIMDFloat vb = simd::set(b);
+    for (size_t i = 0; i <= length-kSIMDWidth; i+=kSIMDWidth) {
+      SIMDFloat c = simd::load(&values[i]);
+      SIMDFloat va = simd::load(&a.values[i]);
+     simd::store(&values[i], simd::fmadd(va, vb, c));
+    }
+    return *this;
+  }
+
+  inline Vec<float, length>& FMA(const Vec<float, length> &a, const Vec<float, length> &b) {
+    static_assert(length == 8 * (length / 8), "Input length is not multiple of 16");
+    for (size_t i = 0; i <= length-kSIMDWidth; i+=kSIMDWidth) {
+      SIMDFloat c = simd::load(&values[i]);
+      SIMDFloat va = simd::load(&a.values[i]);
+      SIMDFloat vb = simd::load(&b.values[i]);
+      simd::store(&values[i], simd::fmadd(va, vb, c));
+    }
+    return *this;
+  }
+  
+  template<typename t>
+  float dot(const Vec<t, length> &other) const {
+    static_assert(length == 8 * (length / 8), "Input length is not multiple of 16");
+    SIMDFloat c = simd::set(0);
+    for (size_t i = 0; i <= length-kSIMDWidth; i+=kSIMDWidth) {
+      SIMDFloat va = simd::load(&values[i]);
+      SIMDFloat vb = simd::load(&other.values[i]);
+      c = simd::fmadd(va, vb, c);
+    }
+    return simd::sum(c);
+  }
+  
+  template<size_t new_length>
+  Vec<float, new_length> reduce_sum() const {
+      static_assert(new_length % kSIMDWidth == 0, "Reducing to non-SIMDWidth multiple");
+      static_assert(new_length < length, "Reduction not reducing");
+      static_assert(length % new_length == 0, "Invalid reduction size");
+      Vec<float, new_length> result;
+      for (size_t i = 0; i <= new_length-kSIMDWidth; i+=kSIMDWidth) {
+          SIMDFloat c = simd::set(0);
+          for (size_t j = 0; j <= length - new_length; j+=new_length) {
+              SIMDFloat v = simd::load(&values[i+j]);
+              c = simd::add(c, v);
+          }
+          simd::store(&result.values[i], c);
+      }
+      return result;
+  }
+  
+  
+  template<size_t new_length>
+  Vec<float, new_length> reduce_weighted(Vec<float, length> weights) const {
+      static_assert(new_length % kSIMDWidth == 0, "Reducing to non-SIMDWidth multiple");
+      static_assert(new_length < length, "Reduction not reducing");
+      static_assert(length % new_length == 0, "Invalid reduction size");
+      Vec<float, new_length> result;
+      for (size_t i = 0; i <= new_length-kSIMDWidth; i+=kSIMDWidth) {
+          SIMDFloat c = simd::set(0);
+          for (size_t j = 0; j <= length - new_length; j+=new_length) {
+              SIMDFloat v1 = simd::load(&values[i+j]);
+              SIMDFloat v2 = simd::load(&weights.values[i+j]);
+              c = simd::fmadd(v1, v2, c);
+          }
+          simd::store(&result.values[i], c);
+      }
+      return result;
+  }
+  
+  inline float& operator[](std::size_t idx) { return values[idx]; }
+  inline const float operator[](std::size_t idx) const { return values[idx]; }
+  
+  alignas(kFloatVecAlignment) float values[length];
+};
+
+template<size_t length>
+struct Vec<int32_t, length> {
+  Vec() {}
+
+  Vec(int32_t val) {
+    for (size_t i = 0; i < length; ++i) {
+      values[i] = val;
+    }
+  }
+
+  inline size_t size() const {
+    return length;
+  }
+
+  int32_t sum() const {
+    SIMDInt acc = simd::set_epi32(0);
+    for (size_t i = 0; i <= length-kSIMDInt32Width; i+=kSIMDInt32Width) {
+      acc = simd::add_epi32(acc, simd::load_int(&values[i]));
+    }
+    return simd::sum_epi32(acc);
+  }
+
+  inline Vec<int32_t, length>& operator+=(const Vec<int32_t, length> &rhs) {
+    #pragma GCC unroll 32
+    for (size_t i = 0; i <= length-kSIMDInt32Width; i+=kSIMDInt32Width) {
+      SIMDInt v1 = simd::load_int(&values[i]);
+      SIMDInt v2 = simd::load_int(&rhs.values[i]);
+      simd::store_int(&values[i], simd::add_epi32(v1, v2));
+    }
+    return *this;
+  }
+
+  // Adds a.madd(b) to this vector without materialising the intermediate result.
+  inline Vec<int32_t, length>& add_madd(const Vec<int16_t, 2 * length> &a,
+                                        const Vec<int16_t, 2 * length> &b) {
+    #pragma GCC unroll 32
+    for (size_t i = 0; i <= length-kSIMDInt32Width; i+=kSIMDInt32Width) {
+      SIMDInt c = simd::load_int(&values[i]);
+      SIMDInt va = simd::load_int(&a.values[2 * i]);
+      SIMDInt vb = simd::load_int(&b.values[2 * i]);
+      simd::store_int(&values[i], simd::dpwssd_epi32(c, va, vb));
+    }
+    return *this;
+  }
+
+  inline int32_t& operator[](std::size_t idx) { return values[idx]; }
+  inline const int32_t operator[](std::size_t idx) const { return values[idx]; }
+
+  alignas(kIntVecAlignment) int32_t values[length];
+};
+
+// Fixed point vector. Addition and subtraction wrap around, so incremental updates
+// stay exact as long as the final values are in range.
+template<size_t length>
+struct Vec<int16_t, length> {
+  static_assert(length % kSIMDInt16Width == 0, "Input length is not multiple of SIMD width");
+
+  Vec() {}
+
+  Vec(int16_t val) {
+    for (size_t i = 0; i < length; ++i) {
+      values[i] = val;
+    }
+  }
+
+  inline size_t size() const {
+    return length;
+  }
+
+  inline Vec<int16_t, length>& operator+=(const Vec<int16_t, length> &rhs) {
+    #pragma GCC unroll 32
+    for (size_t i = 0; i <= length-kSIMDInt16Width; i+=kSIMDInt16Width) {
+      SIMDInt v1 = simd::load_int(&values[i]);
+      SIMDInt v2 = simd::load_int(&rhs.values[i]);
+      simd::store_int(&values[i], simd::add_epi16(v1, v2));
+    }
+    return *this;
+  }
+
+  inline Vec<int16_t, length>& operator-=(const Vec<int16_t, length> &rhs) {
+    #pragma GCC unroll 32
+    for (size_t i = 0; i <= length-kSIMDInt16Width; i+=kSIMDInt16Width) {
+      SIMDInt v1 = simd::load_int(&values[i]);
+      SIMDInt v2 = simd::load_int(&rhs.values[i]);
+      simd::store_int(&values[i], simd::sub_epi16(v1, v2));
+    }
+    return *this;
+  }
+
+  // Clamps to [0, max_val] and then divides by 2^shift.
+  [[nodiscard]] inline Vec<int16_t, length> clipped_relu(const int16_t max_val, const int shift) const {
+    const SIMDInt zero = simd::set_epi16(0);
+    const SIMDInt max_simd = simd::set_epi16(max_val);
+    Vec<int16_t, length> result;
+    #pragma GCC unroll 32
+    for (size_t i = 0; i <= length-kSIMDInt16Width; i += kSIMDInt16Width) {
+      SIMDInt v1 = simd::load_int(&values[i]);
+      v1 = simd::min_epi16(simd::max_epi16(v1, zero), max_simd);
+      simd::store_int(&result.values[i], simd::srai_epi16(v1, shift));
+    }
+    return result;
+  }
+
+  // Elementwise product where neighbouring pairs are summed in 32 bit precision.
+  [[nodiscard]] inline Vec<int32_t, length / 2> madd(const Vec<int16_t, length> &other) const {
+    Vec<int32_t, length / 2> result;
+    #pragma GCC unroll 32
+    for (size_t i = 0; i <= length-kSIMDInt16Width; i+=kSIMDInt16Width) {
+      SIMDInt va = simd::load_int(&values[i]);
+      SIMDInt vb = simd::load_int(&other.values[i]);
+      simd::store_int(&result.values[i / 2], simd::madd_epi16(va, vb));
+    }
+    return result;
+  }
+
+  int32_t dot(const Vec<int16_t, length> &other) const {
+    SIMDInt c = simd::set_epi32(0);
+    for (size_t i = 0; i <= length-kSIMDInt16Width; i+=kSIMDInt16Width) {
+      SIMDInt va = simd::load_int(&values[i]);
+      SIMDInt vb = simd::load_int(&other.values[i]);
+      c = simd::dpwssd_epi32(c, va, vb);
+    }
+    return simd::sum_epi32(c);
+  }
+
+  inline int16_t& operator[](std::size_t idx) { return values[idx]; }
+  inline const int16_t operator[](std::size_t idx) const { return values[idx]; }
+
+  alignas(kIntVecAlignment) int16_t values[length];
+};
+
+template<typename t, size_t l>
+Vec<t,l> operator*(Vec<t,l> lhs, const int rhs) {
+  lhs *= rhs;
+  return lhs;
+}
+template<typename t, size_t l>
+Vec<t,l> operator/(Vec<t,l> lhs, const int rhs) {
+  lhs /= rhs;
+  return lhs;
+}
+template<typename t, size_t l>
+Vec<t,l> operator*(const double &rhs, Vec<t,l> lhs) {
+  lhs *= rhs;
+  return lhs;
+}
+template<typename t, size_t l>
+Vec<t,l> operator*(const int &rhs, Vec<t,l> lhs) { return lhs * rhs; }
+template<typename t, size_t l>
+Vec<t,l> operator-(Vec<t,l> score) {
+  for (size_t i = 0; i < l; ++i) {
+    score[i] = -score[i];
+  }
+  return score;
+}
+template<typename t, size_t l>
+inline bool operator==(const Vec<t,l>& lhs, const Vec<t,l>& rhs) {
+  bool res = true;
+  for (size_t i = 0; i < l; ++i) {
+    res = res && lhs[i] == rhs[i];
+  }
+  return res;
+}
+template<typename t, size_t l>
+inline bool operator!=(const Vec<t,l>& lhs, const Vec<t,l>& rhs) { return !(lhs == rhs); }
+
+//template<typename t, size_t l>
+//Vec<t,l> squared_differences(const Vec<t,l> &v1, const Vec<t,l> &v2) {
+  //Vec<t,l> v;
+  //for (size_t i = 0; i < l; ++i) {
+    //v[i] = std::pow(v1[i] - v2[i], 2);
+  //}
+  //return v;
+//}
@@ -48,6 +48,11 @@ int main(int argc, char **argv) {
     return 0;
   }
 
+  if (argc > 1 && Equals(argv[1], "ttd")) {
+    benchmark::RunTimeToDepthCommand(argc, argv);
+    return 0;
+  }
+
   //The following commented lines remain to remind me how to do stuff =)
   //benchmark::EntropyLossTimedSuite(Milliseconds(10));
   //benchmark::TimeToDepthSuite();
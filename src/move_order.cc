@@ -56,17 +56,18 @@ void Init() {
   }
 }
 
-void insertion_sort(std::vector<Move> &moves, int start_idx = 0) {
-  const size_t size = moves.size();
-  for (int i = start_idx + 1; i < size; ++i) {
-    Move key = moves[i];
-    const Move key_val = key >> 16;
-    int j = i - 1;
-    while (j >= start_idx && (moves[j] >> 16) < key_val) {
-      moves[j + 1] = moves[j];
+void insertion_sort(MoveList &moves, const size_t start_idx = 0) {
+  for (size_t i = start_idx + 1; i < moves.size(); ++i) {
+    const Move key = moves[i];
+    const MoveScore key_score = moves.score(i);
+    size_t j = i;
+    while (j > start_idx && moves.score(j - 1) < key_score) {
+      moves[j] = moves[j - 1];
+      moves.score(j) = moves.score(j - 1);
       --j;
     }
-    moves[j + 1] = key;
+    moves[j] = key;
+    moves.score(j) = key_score;
   }
 }
 
@@ -83,14 +84,29 @@ MoveScore get_move_priority(const Move move, search::Thread &t, const Move best)
   return t.get_history_score(t.board.get_turn(), GetMoveSource(move), GetMoveDestination(move)) / 1000;
 }
 
-void Sort(std::vector<Move> &moves, search::Thread &t, const Move best_move) {
-  for (size_t i = 0; i < moves.size(); ++i) {
-    moves[i] |= (get_move_priority(moves[i], t, best_move) << 16);
+// Moves the first of the highest scored moves to start_idx and keeps the order
+// of the others, so repeated selection gives the same order as insertion_sort.
+void select_best(MoveList &moves, const size_t start_idx) {
+  size_t best_idx = start_idx;
+  for (size_t i = start_idx + 1; i < moves.size(); ++i) {
+    if (moves.score(i) > moves.score(best_idx)) {
+      best_idx = i;
+    }
   }
-  insertion_sort(moves);
+  for (size_t i = best_idx; i > start_idx; --i) {
+    moves.swap(i, i - 1);
+  }
+}
+
+// Most cutoffs happen within the first few moves, after that the remaining
+// moves are sorted all at once.
+constexpr size_t kNumSelectedMoves = 3;
+
+void Sort(MoveList &moves, search::Thread &t, const Move best_move) {
   for (size_t i = 0; i < moves.size(); ++i) {
-    moves[i] &= 0xFFFFL;
+    moves.score(i) = get_move_priority(moves[i], t, best_move);
   }
+  insertion_sort(moves);
 }
 
 template<bool in_check> inline MoveScore GetFeatureValue(const size_t index) {
@@ -302,27 +318,117 @@ MoveScore GetMoveWeight(const Move move, search::Thread &t, const MoveOrderInfo
   return move_weight / 16000;
 }
 
-// Sorten moves according to weights given by some classifier
-void SortML(std::vector<Move> &moves, search::Thread &t,
-                 const Move best_move, const size_t start_idx) {
+void ScoreML(MoveList &moves, search::Thread &t,
+             const Move best_move, const size_t start_idx) {
   MoveOrderInfo info(t.board, best_move);
 
   //Move ordering is very different if we are in check. Eg a queen move not capturing anything is less likely.
   if (t.board.InCheck()) {
     for (size_t i = start_idx; i < moves.size(); ++i) {
-      moves[i] |= (GetMoveWeight<true>(moves[i], t, info) << 16);
+      moves.score(i) = GetMoveWeight<true>(moves[i], t, info);
     }
   }
   else {
     for (size_t i = start_idx; i < moves.size(); ++i) {
-      moves[i] |= (GetMoveWeight<false>(moves[i], t, info) << 16);
+      moves.score(i) = GetMoveWeight<false>(moves[i], t, info);
     }
   }
+}
 
+// Sorten moves according to weights given by some classifier
+void SortML(MoveList &moves, search::Thread &t,
+                 const Move best_move, const size_t start_idx) {
+  ScoreML(moves, t, best_move, start_idx);
   insertion_sort(moves, start_idx);
-  for (size_t i = start_idx; i < moves.size(); ++i) {
-    moves[i] &= 0xFFFFL;
+}
+
+MoveList &MovePicker::generate() {
+  if (!generated) {
+    moves = t.board.GetMoves<kNonQuiescent>();
+    generated = true;
+  }
+  return moves;
+}
+
+Move MovePicker::next() {
+  switch (stage) {
+    case kTTMove:
+      stage = kGenerate;
+      // Once moves are generated, the TT move is only picked if it is in the list.
+      if (!generated && tt_move != kNullMove && t.board.IsMoveLegal(tt_move)) {
+        tt_move_picked = true;
+        ++num_picked;
+        return tt_move;
+      }
+      [[fallthrough]];
+    case kGenerate:
+      generate();
+      stage = kScore;
+      if (tt_move != kNullMove) {
+        auto it = std::find(moves.begin(), moves.end(), tt_move);
+        assert(!tt_move_picked || it != moves.end());
+        if (it != moves.end()) {
+          moves.swap(it - moves.begin(), 0);
+          idx = 1;
+          if (!tt_move_picked) {
+            ++num_picked;
+            return tt_move;
+          }
+        }
+      }
+      [[fallthrough]];
+    case kScore:
+      ScoreML(moves, t, tt_move, idx);
+      stage = kPick;
+      [[fallthrough]];
+    case kPick:
+      if (idx >= moves.size()) {
+        return kNullMove;
+      }
+      if (idx == 1 && rotation && moves.size() > 2) {
+        if (!sorted) {
+          insertion_sort(moves, 1);
+          sorted = true;
+        }
+        // Scores are no longer needed once the moves are sorted.
+        std::rotate(moves.begin() + 1, moves.begin() + 1 + rotation % (moves.size() - 1), moves.end());
+      }
+      if (!sorted) {
+        if (num_picked < kNumSelectedMoves) {
+          select_best(moves, idx);
+        }
+        else {
+          insertion_sort(moves, idx);
+          sorted = true;
+        }
+      }
+      ++num_picked;
+      return moves[idx++];
+  }
+  return kNullMove;
+}
+
+QuiescentMovePicker::QuiescentMovePicker(search::Thread &t, const Move best_move) :
+    moves(t.board.GetMoves<kQuiescent>()) {
+  for (size_t i = 0; i < moves.size(); ++i) {
+    moves.score(i) = get_move_priority(moves[i], t, best_move);
+  }
+}
+
+Move QuiescentMovePicker::next() {
+  if (idx >= moves.size()) {
+    return kNullMove;
+  }
+  if (!sorted) {
+    if (idx < kNumSelectedMoves) {
+      select_best(moves, idx);
+    }
+    else {
+      insertion_sort(moves, idx);
+      sorted = true;
+    }
   }
+  return moves[idx++];
 }
 
 #ifdef TUNE_ORDER
@@ -37,10 +37,57 @@
 namespace move_order {
 
 void Init();
-void Sort(std::vector<Move> &moves, search::Thread &t, const Move best_move);
-void SortML(std::vector<Move> &moves, search::Thread &t,
+void Sort(MoveList &moves, search::Thread &t, const Move best_move);
+void SortML(MoveList &moves, search::Thread &t,
             const Move best_move = kNullMove, const size_t start_idx = 0);
 
+// Hands out the moves of a search node one at a time. The TT move is tried
+// before any moves are generated, the remaining moves are only generated and
+// scored once they are needed. The order is the same as with SortML.
+class MovePicker {
+ public:
+  MovePicker(search::Thread &t, const Move tt_move) : t(t), tt_move(tt_move) {}
+
+  // Generates all moves up front. Moves may be removed from the returned list
+  // as long as nothing has been picked yet.
+  MoveList &generate();
+  // Helpers continue with different root moves after the first.
+  void set_rotation(const size_t offset) { rotation = offset; }
+
+  // Returns kNullMove once all moves have been picked.
+  Move next();
+  size_t get_num_picked() const { return num_picked; }
+
+ private:
+  enum Stage { kTTMove, kGenerate, kScore, kPick };
+
+  search::Thread &t;
+  const Move tt_move;
+  MoveList moves;
+  Stage stage = kTTMove;
+  bool generated = false;
+  bool tt_move_picked = false;
+  bool sorted = false;
+  size_t idx = 0;
+  size_t rotation = 0;
+  size_t num_picked = 0;
+};
+
+// Picks quiescence search moves in the order given by Sort, only selecting the
+// best few moves before sorting the rest.
+class QuiescentMovePicker {
+ public:
+  QuiescentMovePicker(search::Thread &t, const Move best_move);
+
+  bool empty() const { return moves.empty(); }
+  Move next();
+
+ private:
+  MoveList moves;
+  bool sorted = false;
+  size_t idx = 0;
+};
+
 #ifdef TUNE_ORDER
 
 void SetWeight(size_t idx, MoveScore value);
@@ -9,6 +9,10 @@
 #include <vector>
 #include <cmath>
 #include <list>
+#include <thread>
+#include <algorithm>
+#include <functional>
+#include <string>
 
 //INCBIN(float_t, NetWeights, "rnet16H64h.bin");
 //INCBIN(float_t, NetWeights, "rnet8H96e.bin");
@@ -34,157 +38,212 @@ FullLayerType full_layer_bias(0);
 std::vector<FullLayerType> full_output_weights(3, 0);
 std::vector<FullLayerType> m_full_output_weights(3, 0);
 
-Array2d<int32_t, 64, 64> square_offset;
+// Quantized copies of the weights above. The accumulated layers share a fixed
+// point scale, while the output layers each get the largest power of two scale
+// for which all of their weights fit in kQMaxWeight.
+constexpr int32_t kQActivationScale = 1024;
+// Activations are clipped to [0, 8] and then shifted right before the output
+// layers. This keeps each 32 bit madd lane from overflowing.
+constexpr int kQActivationShift = 2;
+constexpr int16_t kQClippedMax = 8 * kQActivationScale;
+constexpr float_t kQMaxWeight = 1 << 13;
 
-void init_square_offset() {
-  for (size_t src = 0; src < 64; ++src) {
-    for (size_t des = 0; des < 64; ++des) {
-      int32_t x = 7 + GetSquareX(src) - GetSquareX(des);
-      int32_t y = 7 + GetSquareY(src) - GetSquareY(des);
-      square_offset[src][des] = y * 15 + x;
-    }
-  }
-}
+std::vector<QNetLayerType> q_net_input_weights(12 * 12 * 15 * 15, 0);
+std::vector<QNetLayerType> q_bias_layer_one(12 * 8 * 8, 0);
 
-void AddRelative(const NetPieceModule &p_src, const NetPieceModule &p_des, NetLayerType &features) {
-  size_t idx = (p_src.pt * 12 + p_des.pt) * 225 + square_offset[p_src.sq][p_des.sq];
-  features += net_input_weights[idx];
-}
+std::vector<QNetLayerType> q_output_weights(3 * 12 * 8 * 8, 0);
+std::vector<QNetLayerType> q_m_output_weights(3 * 12 * 8 * 8, 0);
+float_t q_output_dequant = 1;
 
-void RemoveRelative(const std::tuple<Piece, Square> &p_src, const NetPieceModule &p_des, NetLayerType &features) {
-  const auto [src_pt, src_sq] = p_src;
-  size_t idx = (src_pt * 12 + p_des.pt) * 225 + square_offset[src_sq][p_des.sq];
-  features -= net_input_weights[idx];
-}
+std::vector<QFullLayerType> q_full_layer_weights(12 * 64, 0);
+QFullLayerType q_full_layer_bias(0);
 
-void EvalPieceRelations(PieceList &piece_modules) {
-  for (size_t i = 0; i < piece_modules.size(); ++i) {
-    NetLayerType features = piece_modules[i].features;
-    for (size_t j = 0; j < i; ++j) {
-      AddRelative(piece_modules[j], piece_modules[i], features);
-    }
-    for (size_t j = i+1; j < piece_modules.size(); ++j) {
-      AddRelative(piece_modules[j], piece_modules[i], features);
-    }
-    piece_modules[i].features = features;
-  }
-}
+std::vector<QFullLayerType> q_full_output_weights(3, 0);
+std::vector<QFullLayerType> q_m_full_output_weights(3, 0);
+float_t q_full_output_dequant = 1;
 
-template<Color color>
-inline void AddPieceType(const Board &board, const PieceType pt,
-                         PieceList &piece_modules,
-                         FullLayerType &full_layer) {
-  constexpr int32_t c_offset = color == kWhite ? 0 : 6;
+bool use_quantized = false;
 
-  for (BitBoard pieces = board.get_piece_bitboard(color, pt); pieces; bitops::PopLSB(pieces)) {
-    Square piece_square = bitops::NumberOfTrailingZeros(pieces);
-    size_t bias_idx = (pt + c_offset) * 8 * 8 + piece_square;
-    NetPieceModule npm = {bias_layer_one[bias_idx], (pt + c_offset), piece_square};
-    piece_modules.push_back(npm);
+// Gives the evaluation code below uniform access to the float and quantized
+// versions of the accumulated layers.
+template<typename T>
+struct Weights;
 
-    full_layer += full_layer_weights[(pt + c_offset) * 64 + piece_square];
-  }
-}
+template<>
+struct Weights<float_t> {
+  static const NetLayerType& input(size_t idx) { return net_input_weights[idx]; }
+  static const NetLayerType& bias(size_t idx) { return bias_layer_one[idx]; }
+  static const FullLayerType& full(size_t idx) { return full_layer_weights[idx]; }
+  static const FullLayerType& full_bias() { return full_layer_bias; }
+};
 
-inline void AddAllPieceTypes(const Board &board,
-                         PieceList &piece_modules,
-                         FullLayerType &full_layer) {
-  for (PieceType piece_type = kPawn; piece_type <= kKing; ++piece_type) {
-      AddPieceType<kWhite>(board, piece_type, piece_modules, full_layer);
-      AddPieceType<kBlack>(board, piece_type, piece_modules, full_layer);
-  }
-}
+template<>
+struct Weights<int16_t> {
+  static const QNetLayerType& input(size_t idx) { return q_net_input_weights[idx]; }
+  static const QNetLayerType& bias(size_t idx) { return q_bias_layer_one[idx]; }
+  static const QFullLayerType& full(size_t idx) { return q_full_layer_weights[idx]; }
+  static const QFullLayerType& full_bias() { return q_full_layer_bias; }
+};
 
-template<Color color>
-inline void AddPieceType(const Board &board, const PieceType pt,
-                         PieceList &piece_modules,
-                         FullLayerType &full_layer, const BitBoard mask) {
-  constexpr int32_t c_offset = color == kWhite ? 0 : 6;
+}
 
-  for (BitBoard pieces = board.get_piece_bitboard(color, pt) & mask; pieces; bitops::PopLSB(pieces)) {
-    Square piece_square = bitops::NumberOfTrailingZeros(pieces);
-    size_t bias_idx = (pt + c_offset) * 8 * 8 + piece_square;
-    NetPieceModule npm = {bias_layer_one[bias_idx], (pt + c_offset), piece_square};
-    piece_modules.push_back(npm);
+namespace net_evaluation {
 
-    full_layer += full_layer_weights[(pt + c_offset) * 64 + piece_square];
+// Each backend compiles the evaluation kernels with its own instruction set. Builds
+// with runtime dispatch target a baseline CPU and add the newer backends on top.
+// Everything shared with the rest of the engine is included above, so only code in
+// the backend namespaces is compiled for the newer instruction sets.
+namespace generic {
+#include "net_kernels.h"
+}
+
+#if defined(SIMD_DISPATCH)
+#if defined(__clang__) || !defined(__GNUC__)
+#error "Builds with runtime dispatch rely on GCC's target pragma."
+#endif
+
+#pragma GCC push_options
+#pragma GCC target("avx2,fma,bmi,bmi2,popcnt")
+#define SIMD_AVX
+#define SIMD_AVX2
+#define SIMD_FMA
+namespace avx2 {
+#include "linear_algebra_impl.h"
+#include "net_kernels.h"
+}
+#undef SIMD_AVX
+#undef SIMD_AVX2
+#undef SIMD_FMA
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512bw,avx512vl,avx512dq,avx2,fma,bmi,bmi2,popcnt")
+#define SIMD_AVX
+#define SIMD_AVX2
+#define SIMD_FMA
+#define SIMD_AVX512
+#define SIMD_AVX512VL
+namespace avx512 {
+#include "linear_algebra_impl.h"
+#include "net_kernels.h"
+}
+#undef SIMD_AVX
+#undef SIMD_AVX2
+#undef SIMD_FMA
+#undef SIMD_AVX512
+#undef SIMD_AVX512VL
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512bw,avx512vl,avx512dq,avx512vnni,avx2,fma,bmi,bmi2,popcnt")
+#define SIMD_AVX
+#define SIMD_AVX2
+#define SIMD_FMA
+#define SIMD_AVX512
+#define SIMD_AVX512VL
+#define SIMD_AVX512VNNI
+namespace avx512vnni {
+#include "linear_algebra_impl.h"
+#include "net_kernels.h"
+}
+#undef SIMD_AVX
+#undef SIMD_AVX2
+#undef SIMD_FMA
+#undef SIMD_AVX512
+#undef SIMD_AVX512VL
+#undef SIMD_AVX512VNNI
+#pragma GCC pop_options
+#endif
+
+struct Backend {
+  std::string name;
+  bool (*is_supported)();
+  Score (*score_board)(const Board &board, const bool quantized);
+  Score (*score_thread)(search::Thread &t, const bool quantized);
+};
+
+// Ordered by preference. The last backend is always supported.
+const std::vector<Backend> backends {
+#if defined(SIMD_DISPATCH)
+  {"AVX512-VNNI", []() {
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")
+        && __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512dq")
+        && __builtin_cpu_supports("avx512vnni") && __builtin_cpu_supports("avx2")
+        && __builtin_cpu_supports("fma") && __builtin_cpu_supports("bmi2");
+  }, avx512vnni::ScoreBoard, avx512vnni::ScoreThread},
+  {"AVX512", []() {
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")
+        && __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512dq")
+        && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")
+        && __builtin_cpu_supports("bmi2");
+  }, avx512::ScoreBoard, avx512::ScoreThread},
+  {"AVX2", []() {
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")
+        && __builtin_cpu_supports("bmi2");
+  }, avx2::ScoreBoard, avx2::ScoreThread},
+#endif
+  {settings::compile_arch, []() { return true; }, generic::ScoreBoard, generic::ScoreThread},
+};
+
+const Backend *backend = &backends.back();
+
+void SelectBackend() {
+#if defined(SIMD_DISPATCH)
+  __builtin_cpu_init();
+#endif
+  for (const Backend &candidate : backends) {
+    if (candidate.is_supported()) {
+      backend = &candidate;
+      return;
+    }
   }
 }
 
-inline void AddAllPieceTypes(const Board &board,
-                         PieceList &piece_modules,
-                         FullLayerType &full_layer, const BitBoard mask) {
-  for (PieceType piece_type = kPawn; piece_type <= kKing; ++piece_type) {
-      AddPieceType<kWhite>(board, piece_type, piece_modules, full_layer, mask);
-      AddPieceType<kBlack>(board, piece_type, piece_modules, full_layer, mask);
+Score ScoreBoard(const Board &board) {
+  Score score = backend->score_board(board, use_quantized);
+  if (contempt[board.get_turn()] != 0) {
+    return AddContempt(score, board.get_turn());
   }
+  return score;
 }
 
-}
-
-namespace net_evaluation {
-
-template<Color color>
-Score PerspectiveNetForward(const PieceList &piece_modules,
-                 const FullLayerType &_full_layer) {
-  std::array<NetLayerType, 3> output_helpers{0, 0, 0};
-  for (size_t piece_idx = 0; piece_idx < piece_modules.size(); piece_idx++) {
-    auto features = piece_modules[piece_idx].features.clipped_relu(8);
-    size_t idx = 3 * (piece_modules[piece_idx].pt * 8 * 8 + piece_modules[piece_idx].sq);
-    assert(idx + 2 < output_weights.size());
-    for (size_t output_idx = 0; output_idx < 3; output_idx++) {
-      if constexpr (color == kWhite) {
-        output_helpers[output_idx].FMA(output_weights[idx + output_idx], features);
-      }
-      else {
-        output_helpers[output_idx].FMA(m_output_weights[idx + output_idx], features);
-      }
+void NetScoreBoards(const std::vector<Board> &boards, std::vector<Score> &scores,
+                    const size_t begin, const size_t end) {
+  for (size_t i = begin; i < end; ++i) {
+    const Color turn = boards[i].get_turn();
+    scores[i] = backend->score_board(boards[i], use_quantized);
+    if (contempt[turn] != 0) {
+      scores[i] = AddContempt(scores[i], turn);
     }
   }
-  
-  auto full_layer = _full_layer.clipped_relu(8);
-  
-  float_t sum = 0;
-  std::array<float_t, 3> outcomes;
-  for (size_t i = 0; i < 3; ++i) {
-    if constexpr (color == kWhite) {
-      outcomes[i] = full_layer.dot(full_output_weights[i]);
-    }
-    else {
-      outcomes[i] = full_layer.dot(m_full_output_weights[i]);
-    }
-    outcomes[i] += output_helpers[i].sum() + output_bias[i];
-  }
-  
-  float_t max_logit = *std::max_element(outcomes.begin(), outcomes.end());
-  
-  for (size_t i = 0; i < 3; ++i) {
-    outcomes[i] = std::exp(outcomes[i] - max_logit);
-    sum += outcomes[i];
-  }
-  
-  float_t win = outcomes[0] / sum;
-  float_t loss = outcomes[2] / sum;
-  return WDLScore::from_pct(win, loss);
 }
 
-Score NetForward(const PieceList &piece_modules,
-                 const FullLayerType &_full_layer, const Color color) {
-    if (color == kWhite)
-      return PerspectiveNetForward<kWhite>(piece_modules, _full_layer);
-    return PerspectiveNetForward<kBlack>(piece_modules, _full_layer);
-}
+std::vector<Score> ScoreBoards(const std::vector<Board> &boards) {
+  std::vector<Score> scores(boards.size());
 
-Score ScoreBoard(const Board &board) {
-  PieceList piece_modules;
-  FullLayerType full_layer = full_layer_bias;
-  AddAllPieceTypes(board, piece_modules, full_layer);
-  EvalPieceRelations(piece_modules);
-  if (contempt[board.get_turn()] != 0) {
-    return AddContempt(NetForward(piece_modules, full_layer, board.get_turn()),
-                       board.get_turn());
+  // Spawning a thread is only worth it if it gets a reasonable amount of work.
+  constexpr size_t kMinBoardsPerThread = 1024;
+  const size_t max_threads_by_size = std::max<size_t>(1, boards.size() / kMinBoardsPerThread);
+  const size_t thread_count = std::min(search::GetNumThreads(), max_threads_by_size);
+
+  if (thread_count == 1) {
+    NetScoreBoards(boards, scores, 0, boards.size());
+    return scores;
+  }
+
+  std::vector<std::thread> threads;
+  threads.reserve(thread_count);
+  const size_t chunk_size = boards.size() / thread_count;
+  for (size_t i = 0; i < thread_count; ++i) {
+    const size_t begin = i * chunk_size;
+    // The last thread picks up any remainder from integer division
+    const size_t end = (i == thread_count - 1) ? boards.size() : begin + chunk_size;
+    threads.emplace_back(NetScoreBoards, std::cref(boards), std::ref(scores), begin, end);
+  }
+  for (auto& t : threads) {
+    t.join();
   }
-  return NetForward(piece_modules, full_layer, board.get_turn());
+  return scores;
 }
 
 //inline std::tuple<NetPieceModule, NetPieceModule> get_partial()
@@ -193,103 +252,18 @@ Score ScoreBoard(const Board &board) {
 //  return {rAlpha, rBeta, rDepth};
 //}
 
-Score FromScratch(search::Thread &t) {
-  const Depth h = t.get_height();
-  PartialEvaluation &eval = t.evaluations[h];
-  eval.pieces.clear();
-  eval.global_features = full_layer_bias;
-  AddAllPieceTypes(t.board, eval.pieces, eval.global_features);
-  EvalPieceRelations(eval.pieces);
-  if (contempt[t.board.get_turn()] != 0) {
-    return AddContempt(NetForward(eval.pieces, eval.global_features, t.board.get_turn()),
-                       t.board.get_turn());
-  }
-  return NetForward(eval.pieces, eval.global_features, t.board.get_turn());
-}
 
 Score ScoreThread(search::Thread &t) {
-  if (bitops::PopCount(t.board.get_all_pieces()) < 6) {
-    return ScoreBoard(t.board);
+  const HashType hash = t.board.get_hash();
+  Score score;
+  if (!t.probe_eval_cache(hash, score)) {
+    score = backend->score_thread(t, use_quantized);
+    t.save_eval_cache(hash, score);
   }
-  const Depth h = t.get_height();
-  if (h==0) {
-    return FromScratch(t);
-  }
-
-  // Pieces from previous iteration which have not moved
-  PieceList pieces;
-  // Pieces which are no longer on the same squares
-  std::vector<std::tuple<Piece, Square>> no_longer;
-  no_longer.reserve(4);
-  BitBoard mask = 0;
-  for (const NetPieceModule &piece : t.evaluations[h-1].pieces) {
-    Piece b_piece = t.board.get_piece(piece.sq);
-    if (b_piece == kNoPiece) {
-      no_longer.emplace_back(piece.pt, piece.sq);
-      continue;
-    }
-    if (GetPieceColor(b_piece) == kBlack) {
-      b_piece = GetPieceType(b_piece) + 6;
-    }
-    if (b_piece == piece.pt) {
-      pieces.emplace_back(piece);
-      mask |= GetSquareBitBoard(piece.sq);
-    }
-    else {
-      no_longer.emplace_back(piece.pt, piece.sq);
-    }
-  }
-  
-  // Only continue if we expect to save any work.
-  if (pieces.size() <= no_longer.size()) {
-    return FromScratch(t);
-  }
-  
-  // Get partially computed full layer.
-  FullLayerType full_layer = t.evaluations[h-1].global_features;
-  for (const std::tuple<Piece, Square> &removed_piece : no_longer) {
-    const auto [piece, square] = removed_piece;
-    full_layer -= full_layer_weights[piece * 64 + square];
-  }
-  
-  // Add missing pieces
-  const size_t kept = pieces.size();
-  mask = ~mask;
-  AddAllPieceTypes(t.board, pieces, full_layer, mask);
-  
-  // Finish partial evaluation
-  for (size_t i = 0; i < kept; ++i) {
-    NetLayerType features = pieces[i].features;
-    // Remove influence from moved pieces
-    for (const std::tuple<Piece, Square> &removed_piece : no_longer) {
-      RemoveRelative(removed_piece, pieces[i], features);
-    }
-    // Add influence from new pieces
-    for (size_t j = kept; j < pieces.size(); ++j) {
-      AddRelative(pieces[j], pieces[i], features);
-    }
-    pieces[i].features = features;
-  }
-  for (size_t i = kept; i < pieces.size(); ++i) {
-    NetLayerType features = pieces[i].features;
-    for (size_t j = 0; j < i; ++j) {
-      AddRelative(pieces[j], pieces[i], features);
-    }
-    for (size_t j = i+1; j < pieces.size(); ++j) {
-      AddRelative(pieces[j], pieces[i], features);
-    }
-    pieces[i].features = features;
-  }
-  
-  // Store partial evaluation
-  t.evaluations[h].pieces = pieces;
-  t.evaluations[h].global_features = full_layer;
-  // Return full evaluation
   if (contempt[t.board.get_turn()] != 0) {
-    return AddContempt(NetForward(pieces, full_layer, t.board.get_turn()),
-                       t.board.get_turn());
+    return AddContempt(score, t.board.get_turn());
   }
-  return NetForward(pieces, full_layer, t.board.get_turn());
+  return score;
 }
 
 using IP = std::pair<size_t, size_t>;
@@ -308,7 +282,7 @@ void init_conv_weights(size_t &offset) {
     for (size_t piece_out = 0; piece_out < 12; ++piece_out) {
       for (size_t h = 0; h < 15; ++h) {
         for (size_t w = 0; w < 15; ++w) {
-          size_t idx = wrapped_idx({IP(piece_in,12), IP(piece_out,12),
+          size_t idx = wrapped_idx({IP(piece_out,12), IP(piece_in,12),
                                     IP(h,15), IP(w,15)});
           assert(idx < net_input_weights.size());
           for (size_t d = 0; d < block_size; ++d) {
@@ -333,7 +307,7 @@ void init_mirrored_conv_weights(size_t &offset) {
       for (size_t h = 0; h < 15; ++h) {
         size_t m_h = 15 - h - 1;
         for (size_t w = 0; w < 15; ++w) {
-          size_t idx = wrapped_idx({IP(piece_in,12), IP(piece_out,12),
+          size_t idx = wrapped_idx({IP(piece_out,12), IP(piece_in,12),
                                     IP(h,15), IP(w,15)});
           assert(idx < net_input_weights.size());
           for (size_t d = 0; d < (block_size / 2); ++d) {
@@ -535,8 +509,62 @@ void init_mirrored_outputs() {
   }
 }
 
+template<size_t length>
+Vec<int16_t, length> quantize(const Vec<float_t, length> &vec, const float_t scale) {
+  Vec<int16_t, length> result;
+  for (size_t i = 0; i < length; ++i) {
+    assert(std::abs(vec[i] * scale) < 32768);
+    result[i] = static_cast<int16_t>(std::lround(vec[i] * scale));
+  }
+  return result;
+}
+
+template<size_t length>
+void quantize_layer(const std::vector<Vec<float_t, length>> &weights,
+                    std::vector<Vec<int16_t, length>> &q_weights, const float_t scale) {
+  for (size_t idx = 0; idx < weights.size(); ++idx) {
+    q_weights[idx] = quantize(weights[idx], scale);
+  }
+}
+
+// Returns the largest power of two such that all scaled weights fit into kQMaxWeight.
+template<size_t length>
+float_t get_output_scale(const std::vector<Vec<float_t, length>> &weights) {
+  float_t max_weight = 0;
+  for (const Vec<float_t, length> &vec : weights) {
+    for (size_t i = 0; i < length; ++i) {
+      max_weight = std::max(max_weight, std::abs(vec[i]));
+    }
+  }
+  float_t scale = 1;
+  while (max_weight * scale * 2 <= kQMaxWeight) {
+    scale *= 2;
+  }
+  return scale;
+}
+
+void init_quantized_weights() {
+  quantize_layer(net_input_weights, q_net_input_weights, kQActivationScale);
+  quantize_layer(bias_layer_one, q_bias_layer_one, kQActivationScale);
+  quantize_layer(full_layer_weights, q_full_layer_weights, kQActivationScale);
+  q_full_layer_bias = quantize(full_layer_bias, kQActivationScale);
+
+  constexpr float_t activation_scale = kQActivationScale >> kQActivationShift;
+
+  // Mirrored output weights are a permutation of the regular ones, so they share the scale.
+  float_t output_scale = get_output_scale(output_weights);
+  quantize_layer(output_weights, q_output_weights, output_scale);
+  quantize_layer(m_output_weights, q_m_output_weights, output_scale);
+  q_output_dequant = 1 / (output_scale * activation_scale);
+
+  float_t full_output_scale = get_output_scale(full_output_weights);
+  quantize_layer(full_output_weights, q_full_output_weights, full_output_scale);
+  quantize_layer(m_full_output_weights, q_m_full_output_weights, full_output_scale);
+  q_full_output_dequant = 1 / (full_output_scale * activation_scale);
+}
+
 void init_weights() {
-  init_square_offset();
+  SelectBackend();
   size_t offset = 0;
   
   init_mirrored_conv_weights(offset);
@@ -546,6 +574,21 @@ void init_weights() {
   init_mirrored_full_layer_weights(offset);
   init_full_output_weights(offset);
   init_mirrored_outputs();
+  init_quantized_weights();
+}
+
+void SetQuantized(bool quantized) {
+  use_quantized = quantized;
+  // Cached evaluations are specific to the network they were computed with.
+  search::Threads.clear_eval_caches();
+}
+
+bool GetQuantized() {
+  return use_quantized;
+}
+
+std::string GetBackendName() {
+  return backend->name;
 }
 
 void SetContempt(Color color, int32_t value) {
@@ -35,17 +35,30 @@
 #include "board.h"
 #include "search_thread.h"
 #include <vector>
+#include <string>
 
 namespace net_evaluation {
 
 Score ScoreBoard(const Board &board);
 Score ScoreThread(search::Thread &thread);
 
+// Scores many positions at once. The work is split over as many threads as the
+// Threads option allows. Results are identical to calling ScoreBoard on each board.
+std::vector<Score> ScoreBoards(const std::vector<Board> &boards);
+
 // Returns the input features for the net for a specific board position.
 // In the future this may become more complicated, depending on how pieces get encoded.
 std::vector<int32_t> GetNetInputs(const Board &board);
 void init_weights();
 
+// Switches between the float network and the quantized int16_t network.
+void SetQuantized(bool quantized);
+bool GetQuantized();
+
+// Name of the SIMD backend the evaluation runs on. Builds with runtime dispatch
+// pick the best backend the CPU supports in init_weights.
+std::string GetBackendName();
+
 void SetContempt(Color color, int32_t value);
 std::array<Score, 2> GetDrawArray();
 
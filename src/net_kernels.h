@@ -0,0 +1,389 @@
+/*
+ * net_kernels.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonathan Rosenthal
+ */
+
+// Network evaluation kernels for a single SIMD backend. This file deliberately has
+// no include guard, it is included by net_evaluation.cc once per backend, each
+// time in its own namespace. Vec refers to the vector type of that backend, while
+// the weights and the per thread network state are stored with the Vec type of
+// the base build. Both share the same layout, so they are viewed via AsBackend.
+// Accessing an object through an unrelated type breaks strict aliasing, so builds
+// with runtime dispatch are compiled with -fno-strict-aliasing. Other builds only
+// have the generic backend, whose Vec is the base type itself.
+
+template<typename T>
+using BasicPieceModule = ::BasicPieceModule<T, Vec>;
+template<typename T>
+using BasicPieceList = ::BasicPieceList<T, Vec>;
+template<typename T>
+using BasicPartialEvaluation = ::BasicPartialEvaluation<T, Vec>;
+template<typename T>
+using EvaluationStack = std::array<BasicPartialEvaluation<T>, settings::kMaxDepth>;
+
+template<typename T, size_t length>
+inline const Vec<T, length>& AsBackend(const ::Vec<T, length> &vec) {
+  static_assert(sizeof(Vec<T, length>) == sizeof(::Vec<T, length>));
+  return *reinterpret_cast<const Vec<T, length>*>(&vec);
+}
+
+template<typename T>
+inline EvaluationStack<T>& AsBackend(
+    std::array<::BasicPartialEvaluation<T>, settings::kMaxDepth> &evaluations) {
+  static_assert(sizeof(EvaluationStack<T>) == sizeof(evaluations));
+  return *reinterpret_cast<EvaluationStack<T>*>(&evaluations);
+}
+
+template<typename T>
+struct BackendWeights {
+  static const Vec<T, block_size>& input(size_t idx) { return AsBackend(Weights<T>::input(idx)); }
+  static const Vec<T, block_size>& bias(size_t idx) { return AsBackend(Weights<T>::bias(idx)); }
+  static const Vec<T, full_block_size>& full(size_t idx) { return AsBackend(Weights<T>::full(idx)); }
+  static const Vec<T, full_block_size>& full_bias() { return AsBackend(Weights<T>::full_bias()); }
+};
+
+// The conv weights are stored destination piece type major. All weights needed to
+// update a single piece thus lie in one contiguous block of 12 * 15 * 15 vectors.
+// Piece lists are grouped by piece type with the colours interleaved, so the
+// relation loops below visit the 15 * 15 sub-blocks of this block in the order
+// 0, 6, 1, 7, ... rather than strictly increasing.
+//
+// The square offset within a 15 * 15 block is 112 + code(src) - code(des) with
+// code(sq) = 15 * y + x, so an index splits into a part of the source piece and a
+// part of the destination piece. The relation loops compute both parts once per
+// piece, which leaves a single addition per pair. Otherwise the index arithmetic
+// and not the vector additions bound the quantized loops.
+inline int32_t relation_src_part(const PieceType pt, const Square sq) {
+  return pt * 225 + 15 * GetSquareY(sq) + GetSquareX(sq) + 112;
+}
+
+inline int32_t relation_des_part(const PieceType pt, const Square sq) {
+  return pt * 12 * 225 - 15 * GetSquareY(sq) - GetSquareX(sq);
+}
+
+inline size_t relation_idx(const PieceType src_pt, const Square src_sq,
+                           const PieceType des_pt, const Square des_sq) {
+  return relation_src_part(src_pt, src_sq) + relation_des_part(des_pt, des_sq);
+}
+
+template<typename T>
+using RelationParts = std::array<int32_t, BasicPieceList<T>::kMaxPieces>;
+
+template<typename T>
+inline void InitRelationParts(const BasicPieceList<T> &pieces, RelationParts<T> &src_parts) {
+  for (size_t i = 0; i < pieces.size(); ++i) {
+    src_parts[i] = relation_src_part(pieces[i].pt, pieces[i].sq);
+  }
+}
+
+// Adds the relations of the pieces in [begin, end) to a piece with the given
+// destination part.
+template<typename T>
+inline void AddRelatives(const RelationParts<T> &src_parts, const int32_t des_part,
+                         const size_t begin, const size_t end, Vec<T, block_size> &features) {
+  for (size_t j = begin; j < end; ++j) {
+    features += BackendWeights<T>::input(des_part + src_parts[j]);
+  }
+}
+
+template<typename T>
+void RemoveRelative(const std::tuple<Piece, Square> &p_src, const BasicPieceModule<T> &p_des,
+                    Vec<T, block_size> &features) {
+  const auto [src_pt, src_sq] = p_src;
+  features -= BackendWeights<T>::input(relation_idx(src_pt, src_sq, p_des.pt, p_des.sq));
+}
+
+template<typename T>
+void EvalPieceRelations(BasicPieceList<T> &piece_modules) {
+  RelationParts<T> src_parts;
+  InitRelationParts(piece_modules, src_parts);
+  for (size_t i = 0; i < piece_modules.size(); ++i) {
+    const int32_t des_part = relation_des_part(piece_modules[i].pt, piece_modules[i].sq);
+    Vec<T, block_size> features = piece_modules[i].features;
+    AddRelatives(src_parts, des_part, 0, i, features);
+    AddRelatives(src_parts, des_part, i + 1, piece_modules.size(), features);
+    piece_modules[i].features = features;
+  }
+}
+
+template<Color color, typename T>
+inline void AddPieceType(const Board &board, const PieceType pt,
+                         BasicPieceList<T> &piece_modules,
+                         Vec<T, full_block_size> &full_layer) {
+  constexpr int32_t c_offset = color == kWhite ? 0 : 6;
+
+  for (BitBoard pieces = board.get_piece_bitboard(color, pt); pieces; bitops::PopLSB(pieces)) {
+    Square piece_square = bitops::NumberOfTrailingZeros(pieces);
+    size_t bias_idx = (pt + c_offset) * 8 * 8 + piece_square;
+    BasicPieceModule<T> npm = {BackendWeights<T>::bias(bias_idx), (pt + c_offset), piece_square};
+    piece_modules.push_back(npm);
+
+    full_layer += BackendWeights<T>::full((pt + c_offset) * 64 + piece_square);
+  }
+}
+
+template<typename T>
+inline void AddAllPieceTypes(const Board &board,
+                         BasicPieceList<T> &piece_modules,
+                         Vec<T, full_block_size> &full_layer) {
+  for (PieceType piece_type = kPawn; piece_type <= kKing; ++piece_type) {
+      AddPieceType<kWhite>(board, piece_type, piece_modules, full_layer);
+      AddPieceType<kBlack>(board, piece_type, piece_modules, full_layer);
+  }
+}
+
+template<Color color, typename T>
+inline void AddPieceType(const Board &board, const PieceType pt,
+                         BasicPieceList<T> &piece_modules,
+                         Vec<T, full_block_size> &full_layer, const BitBoard mask) {
+  constexpr int32_t c_offset = color == kWhite ? 0 : 6;
+
+  for (BitBoard pieces = board.get_piece_bitboard(color, pt) & mask; pieces; bitops::PopLSB(pieces)) {
+    Square piece_square = bitops::NumberOfTrailingZeros(pieces);
+    size_t bias_idx = (pt + c_offset) * 8 * 8 + piece_square;
+    BasicPieceModule<T> npm = {BackendWeights<T>::bias(bias_idx), (pt + c_offset), piece_square};
+    piece_modules.push_back(npm);
+
+    full_layer += BackendWeights<T>::full((pt + c_offset) * 64 + piece_square);
+  }
+}
+
+template<typename T>
+inline void AddAllPieceTypes(const Board &board,
+                         BasicPieceList<T> &piece_modules,
+                         Vec<T, full_block_size> &full_layer, const BitBoard mask) {
+  for (PieceType piece_type = kPawn; piece_type <= kKing; ++piece_type) {
+      AddPieceType<kWhite>(board, piece_type, piece_modules, full_layer, mask);
+      AddPieceType<kBlack>(board, piece_type, piece_modules, full_layer, mask);
+  }
+}
+
+inline Score OutcomesToScore(std::array<float_t, 3> &outcomes) {
+  float_t sum = 0;
+  float_t max_logit = *std::max_element(outcomes.begin(), outcomes.end());
+
+  for (size_t i = 0; i < 3; ++i) {
+    outcomes[i] = std::exp(outcomes[i] - max_logit);
+    sum += outcomes[i];
+  }
+
+  float_t win = outcomes[0] / sum;
+  float_t loss = outcomes[2] / sum;
+  return WDLScore::from_pct(win, loss);
+}
+
+template<Color color>
+Score PerspectiveNetForward(const BasicPieceList<float_t> &piece_modules,
+                 const Vec<float_t, full_block_size> &_full_layer) {
+  std::array<Vec<float_t, block_size>, 3> output_helpers{0, 0, 0};
+  for (size_t piece_idx = 0; piece_idx < piece_modules.size(); piece_idx++) {
+    auto features = piece_modules[piece_idx].features.clipped_relu(8);
+    size_t idx = 3 * (piece_modules[piece_idx].pt * 8 * 8 + piece_modules[piece_idx].sq);
+    assert(idx + 2 < output_weights.size());
+    for (size_t output_idx = 0; output_idx < 3; output_idx++) {
+      if constexpr (color == kWhite) {
+        output_helpers[output_idx].FMA(AsBackend(output_weights[idx + output_idx]), features);
+      }
+      else {
+        output_helpers[output_idx].FMA(AsBackend(m_output_weights[idx + output_idx]), features);
+      }
+    }
+  }
+  
+  auto full_layer = _full_layer.clipped_relu(8);
+  
+  std::array<float_t, 3> outcomes;
+  for (size_t i = 0; i < 3; ++i) {
+    if constexpr (color == kWhite) {
+      outcomes[i] = full_layer.dot(AsBackend(full_output_weights[i]));
+    }
+    else {
+      outcomes[i] = full_layer.dot(AsBackend(m_full_output_weights[i]));
+    }
+    outcomes[i] += output_helpers[i].sum() + output_bias[i];
+  }
+  
+  return OutcomesToScore(outcomes);
+}
+
+template<Color color>
+Score PerspectiveNetForward(const BasicPieceList<int16_t> &piece_modules,
+                 const Vec<int16_t, full_block_size> &_full_layer) {
+  std::array<Vec<int32_t, block_size / 2>, 3> output_helpers{0, 0, 0};
+  for (size_t piece_idx = 0; piece_idx < piece_modules.size(); piece_idx++) {
+    auto features = piece_modules[piece_idx].features.clipped_relu(kQClippedMax,
+                                                                   kQActivationShift);
+    size_t idx = 3 * (piece_modules[piece_idx].pt * 8 * 8 + piece_modules[piece_idx].sq);
+    assert(idx + 2 < q_output_weights.size());
+    for (size_t output_idx = 0; output_idx < 3; output_idx++) {
+      if constexpr (color == kWhite) {
+        output_helpers[output_idx].add_madd(AsBackend(q_output_weights[idx + output_idx]), features);
+      }
+      else {
+        output_helpers[output_idx].add_madd(AsBackend(q_m_output_weights[idx + output_idx]), features);
+      }
+    }
+  }
+
+  auto full_layer = _full_layer.clipped_relu(kQClippedMax, kQActivationShift);
+
+  std::array<float_t, 3> outcomes;
+  for (size_t i = 0; i < 3; ++i) {
+    int32_t full_sum;
+    if constexpr (color == kWhite) {
+      full_sum = full_layer.dot(AsBackend(q_full_output_weights[i]));
+    }
+    else {
+      full_sum = full_layer.dot(AsBackend(q_m_full_output_weights[i]));
+    }
+    outcomes[i] = full_sum * q_full_output_dequant
+                + output_helpers[i].sum() * q_output_dequant + output_bias[i];
+  }
+
+  return OutcomesToScore(outcomes);
+}
+
+template<typename T>
+Score NetForward(const BasicPieceList<T> &piece_modules,
+                 const Vec<T, full_block_size> &_full_layer, const Color color) {
+    if (color == kWhite)
+      return PerspectiveNetForward<kWhite>(piece_modules, _full_layer);
+    return PerspectiveNetForward<kBlack>(piece_modules, _full_layer);
+}
+
+template<typename T>
+Score NetScoreBoard(const Board &board) {
+  BasicPieceList<T> piece_modules;
+  Vec<T, full_block_size> full_layer = BackendWeights<T>::full_bias();
+  AddAllPieceTypes(board, piece_modules, full_layer);
+  EvalPieceRelations(piece_modules);
+  return NetForward(piece_modules, full_layer, board.get_turn());
+}
+
+template<typename T>
+Score FromScratch(search::Thread &t, EvaluationStack<T> &evaluations) {
+  const Depth h = t.get_height();
+  BasicPartialEvaluation<T> &eval = evaluations[h];
+  eval.pieces.clear();
+  eval.global_features = BackendWeights<T>::full_bias();
+  AddAllPieceTypes(t.board, eval.pieces, eval.global_features);
+  EvalPieceRelations(eval.pieces);
+  eval.hash = t.board.get_hash();
+  t.count_eval_update(search::kEvalFromScratch);
+  return NetForward(eval.pieces, eval.global_features, t.board.get_turn());
+}
+
+inline PieceType NetPieceType(const Piece piece) {
+  return GetPieceType(piece) + 6 * GetPieceColor(piece);
+}
+
+template<typename T>
+inline void AddNetPiece(const PieceType pt, const Square sq, BasicPieceList<T> &piece_modules,
+                        Vec<T, full_block_size> &full_layer) {
+  BasicPieceModule<T> npm = {BackendWeights<T>::bias(pt * 8 * 8 + sq), pt, sq};
+  piece_modules.push_back(npm);
+  full_layer += BackendWeights<T>::full(pt * 64 + sq);
+}
+
+// Finishes an update of the piece features in place. The first kept pieces carry
+// the features of an earlier state, the pieces after them have just been added.
+template<typename T>
+void UpdatePieceRelations(BasicPieceList<T> &pieces, const size_t kept,
+                          const std::tuple<Piece, Square> *no_longer,
+                          const size_t num_no_longer) {
+  RelationParts<T> src_parts;
+  InitRelationParts(pieces, src_parts);
+  for (size_t i = 0; i < kept; ++i) {
+    Vec<T, block_size> features = pieces[i].features;
+    // Remove influence from moved pieces
+    for (size_t j = 0; j < num_no_longer; ++j) {
+      RemoveRelative(no_longer[j], pieces[i], features);
+    }
+    // Add influence from new pieces
+    AddRelatives(src_parts, relation_des_part(pieces[i].pt, pieces[i].sq),
+                 kept, pieces.size(), features);
+    pieces[i].features = features;
+  }
+  for (size_t i = kept; i < pieces.size(); ++i) {
+    const int32_t des_part = relation_des_part(pieces[i].pt, pieces[i].sq);
+    Vec<T, block_size> features = pieces[i].features;
+    AddRelatives(src_parts, des_part, 0, i, features);
+    AddRelatives(src_parts, des_part, i + 1, pieces.size(), features);
+    pieces[i].features = features;
+  }
+}
+
+// Computes the state of a position from the state of the position before the move.
+template<typename T>
+void ApplyMoveDelta(const BasicPartialEvaluation<T> &parent, BasicPartialEvaluation<T> &eval,
+                    const MoveDelta &delta) {
+  std::array<std::tuple<Piece, Square>, 2> no_longer;
+  BitBoard removed = 0;
+  eval.global_features = parent.global_features;
+  for (int32_t i = 0; i < delta.num_removed; ++i) {
+    const PieceType pt = NetPieceType(delta.removed[i].first);
+    const Square square = delta.removed[i].second;
+    no_longer[i] = {pt, square};
+    removed |= GetSquareBitBoard(square);
+    eval.global_features -= BackendWeights<T>::full(pt * 64 + square);
+  }
+  eval.pieces.clear();
+  for (const BasicPieceModule<T> &piece : parent.pieces) {
+    if (!(removed & GetSquareBitBoard(piece.sq))) {
+      eval.pieces.push_back(piece);
+    }
+  }
+  const size_t kept = eval.pieces.size();
+  for (int32_t i = 0; i < delta.num_added; ++i) {
+    AddNetPiece(NetPieceType(delta.added[i].first), delta.added[i].second,
+                eval.pieces, eval.global_features);
+  }
+  UpdatePieceRelations(eval.pieces, kept, no_longer.data(), delta.num_removed);
+}
+
+// Accumulator states are only computed when a position is evaluated. The state
+// of the nearest evaluated ancestor is brought up to date by applying the move
+// deltas since, unless the chain of moves gets longer than recomputing is worth.
+constexpr Depth kMaxEvalUpdateChain = 8;
+
+template<typename T>
+Score NetScoreThread(search::Thread &t, EvaluationStack<T> &evaluations) {
+  if (bitops::PopCount(t.board.get_all_pieces()) < 6) {
+    t.count_eval_update(search::kEvalFromScratch);
+    return NetScoreBoard<T>(t.board);
+  }
+  const Depth h = t.get_height();
+  const Depth max_chain = std::min(h, kMaxEvalUpdateChain);
+  Depth chain = 1;
+  while (chain <= max_chain
+         && evaluations[h - chain].hash != t.board.get_previous_hash(chain)) {
+    ++chain;
+  }
+  if (chain > max_chain) {
+    return FromScratch(t, evaluations);
+  }
+
+  for (Depth plies_ago = chain; plies_ago > 0; --plies_ago) {
+    BasicPartialEvaluation<T> &eval = evaluations[h - plies_ago + 1];
+    ApplyMoveDelta(evaluations[h - plies_ago], eval, t.board.get_move_delta(plies_ago));
+    eval.hash = plies_ago > 1 ? t.board.get_previous_hash(plies_ago - 1) : t.board.get_hash();
+  }
+  t.count_eval_update(chain == 1 ? search::kEvalIncremental : search::kEvalChained);
+  return NetForward(evaluations[h].pieces, evaluations[h].global_features, t.board.get_turn());
+}
+
+Score ScoreBoard(const Board &board, const bool quantized) {
+  if (quantized) {
+    return NetScoreBoard<int16_t>(board);
+  }
+  return NetScoreBoard<float_t>(board);
+}
+
+Score ScoreThread(search::Thread &t, const bool quantized) {
+  if (quantized) {
+    return NetScoreThread(t, AsBackend(t.q_evaluations));
+  }
+  return NetScoreThread(t, AsBackend(t.evaluations));
+}
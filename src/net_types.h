@@ -29,43 +29,62 @@
 
 #include "general/types.h"
 #include "linear_algebra.h"
+#include <array>
 
 // NN types
 constexpr size_t block_size = 32;
 using NetLayerType = Vec<float_t, block_size>;
+using QNetLayerType = Vec<int16_t, block_size>;
 
 constexpr size_t full_block_size = 128;
 using FullLayerType = Vec<float_t, full_block_size>;
+using QFullLayerType = Vec<int16_t, full_block_size>;
 
-struct NetPieceModule {
-  NetLayerType features;
+// Network state is templated on the accumulator type, which is float_t for
+// the regular network and int16_t for the quantized network. The vector type is
+// only exchanged by the SIMD backends of builds with runtime dispatch.
+template<typename T, template<typename, size_t> class V = Vec>
+struct BasicPieceModule {
+  V<T, block_size> features;
   PieceType pt;
   Square sq;
 };
 
-struct PieceList {
+template<typename T, template<typename, size_t> class V = Vec>
+struct BasicPieceList {
   static constexpr size_t kMaxPieces = 32;
 
-  void push_back(const NetPieceModule &npm) { data[count++] = npm; }
-  void emplace_back(const NetPieceModule &npm) { data[count++] = npm; }
+  void push_back(const BasicPieceModule<T, V> &npm) { data[count++] = npm; }
+  void emplace_back(const BasicPieceModule<T, V> &npm) { data[count++] = npm; }
   void clear() { count = 0; }
   size_t size() const { return count; }
 
-  NetPieceModule& operator[](size_t i) { return data[i]; }
-  const NetPieceModule& operator[](size_t i) const { return data[i]; }
+  BasicPieceModule<T, V>& operator[](size_t i) { return data[i]; }
+  const BasicPieceModule<T, V>& operator[](size_t i) const { return data[i]; }
 
-  NetPieceModule* begin() { return data.data(); }
-  NetPieceModule* end() { return data.data() + count; }
-  const NetPieceModule* begin() const { return data.data(); }
-  const NetPieceModule* end() const { return data.data() + count; }
+  BasicPieceModule<T, V>* begin() { return data.data(); }
+  BasicPieceModule<T, V>* end() { return data.data() + count; }
+  const BasicPieceModule<T, V>* begin() const { return data.data(); }
+  const BasicPieceModule<T, V>* end() const { return data.data() + count; }
 
-  std::array<NetPieceModule, kMaxPieces> data;
+  std::array<BasicPieceModule<T, V>, kMaxPieces> data;
   size_t count = 0;
 };
 
-struct PartialEvaluation {
-  PieceList pieces;
-  FullLayerType global_features;
+template<typename T, template<typename, size_t> class V = Vec>
+struct BasicPartialEvaluation {
+  BasicPieceList<T, V> pieces;
+  V<T, full_block_size> global_features;
+  // Hash of the position this state was computed for.
+  HashType hash = 0;
 };
 
+using NetPieceModule = BasicPieceModule<float_t>;
+using PieceList = BasicPieceList<float_t>;
+using PartialEvaluation = BasicPartialEvaluation<float_t>;
+
+using QNetPieceModule = BasicPieceModule<int16_t>;
+using QPieceList = BasicPieceList<int16_t>;
+using QPartialEvaluation = BasicPartialEvaluation<int16_t>;
+
 #endif /* NET_TYPES_H_*/
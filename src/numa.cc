@@ -0,0 +1,162 @@
+/*
+ *  Winter is a UCI chess engine.
+ *
+ *  Copyright (C) 2016 Jonas Kuratli, Jonathan Maurer, Jonathan Rosenthal
+ *  Copyright (C) 2017-2018 Jonathan Rosenthal
+ *
+ *  Winter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Winter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * numa.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonathan Rosenthal
+ */
+
+#include "numa.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+  #include <pthread.h>
+  #include <sched.h>
+#endif
+
+namespace {
+
+// Parses lists such as "0-3,8,10-11" as used by sysfs.
+std::vector<size_t> ParseRangeList(const std::string &list) {
+  std::vector<size_t> result;
+  std::stringstream stream(list);
+  std::string range;
+  while (std::getline(stream, range, ',')) {
+    if (range.empty() || range[0] == '\n') {
+      continue;
+    }
+    const size_t dash = range.find('-');
+    const size_t first = std::stoul(range.substr(0, dash));
+    const size_t last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+    for (size_t i = first; i <= last; ++i) {
+      result.push_back(i);
+    }
+  }
+  return result;
+}
+
+std::string ReadLine(const std::string &file_name) {
+  std::ifstream file(file_name);
+  std::string line;
+  std::getline(file, line);
+  return line;
+}
+
+std::vector<std::vector<size_t> > DetectTopology() {
+  std::vector<std::vector<size_t> > nodes;
+#if defined(__linux__)
+  const std::string base = "/sys/devices/system/node/";
+  for (size_t node : ParseRangeList(ReadLine(base + "online"))) {
+    std::vector<size_t> cpus = ParseRangeList(
+        ReadLine(base + "node" + std::to_string(node) + "/cpulist"));
+    // Nodes consisting only of memory can not run search threads.
+    if (!cpus.empty()) {
+      nodes.emplace_back(cpus);
+    }
+  }
+#endif
+  if (nodes.empty()) {
+    nodes.emplace_back();
+    for (size_t cpu = 0; cpu < std::max(std::thread::hardware_concurrency(), 1u); ++cpu) {
+      nodes.back().push_back(cpu);
+    }
+  }
+  return nodes;
+}
+
+const std::vector<std::vector<size_t> > &GetTopology() {
+  static const std::vector<std::vector<size_t> > topology = DetectTopology();
+  return topology;
+}
+
+bool bind_threads = true;
+thread_local size_t current_node = 0;
+
+}
+
+namespace numa {
+
+size_t GetNumNodes() {
+  return GetTopology().size();
+}
+
+size_t GetNodeForThread(const size_t thread_id) {
+  const std::vector<std::vector<size_t> > &topology = GetTopology();
+  size_t num_cpus = 0;
+  for (const std::vector<size_t> &cpus : topology) {
+    num_cpus += cpus.size();
+  }
+  size_t cpu_idx = thread_id % num_cpus;
+  for (size_t node = 0; node < topology.size(); ++node) {
+    if (cpu_idx < topology[node].size()) {
+      return node;
+    }
+    cpu_idx -= topology[node].size();
+  }
+  return 0;
+}
+
+void BindThisThreadToNode(const size_t node) {
+  current_node = node;
+  // There is nothing to gain from restricting threads on a single node machine.
+  if (GetNumNodes() <= 1) {
+    return;
+  }
+#if defined(__linux__)
+  // Threads of a pool which is no longer bound are allowed on all nodes again.
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (size_t n = 0; n < GetNumNodes(); ++n) {
+    if (bind_threads && n != node) {
+      continue;
+    }
+    for (size_t cpu : GetTopology()[n]) {
+      if (cpu < CPU_SETSIZE) {
+        CPU_SET(cpu, &cpu_set);
+      }
+    }
+  }
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpu_set);
+#endif
+}
+
+void BindThisThread(const size_t thread_id) {
+  BindThisThreadToNode(GetNodeForThread(thread_id));
+}
+
+size_t GetCurrentNode() {
+  return current_node;
+}
+
+void SetBinding(bool value) {
+  bind_threads = value;
+}
+
+bool GetBinding() {
+  return bind_threads;
+}
+
+}
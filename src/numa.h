@@ -0,0 +1,52 @@
+/*
+ *  Winter is a UCI chess engine.
+ *
+ *  Copyright (C) 2016 Jonas Kuratli, Jonathan Maurer, Jonathan Rosenthal
+ *  Copyright (C) 2017-2018 Jonathan Rosenthal
+ *
+ *  Winter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Winter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * numa.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Jonathan Rosenthal
+ */
+
+#ifndef NUMA_H_
+#define NUMA_H_
+
+#include <cstddef>
+
+// Topology of the machine as exposed in /sys/devices/system/node. Machines
+// without NUMA information are treated as a single node holding all CPUs.
+namespace numa {
+
+size_t GetNumNodes();
+// Search threads are assigned to nodes by filling up the CPUs of one node
+// before moving on to the next.
+size_t GetNodeForThread(const size_t thread_id);
+
+// Pins the calling thread to the CPUs of the node if binding is enabled.
+void BindThisThreadToNode(const size_t node);
+void BindThisThread(const size_t thread_id);
+// Node the calling thread was last assigned to, zero for unassigned threads.
+size_t GetCurrentNode();
+
+void SetBinding(bool value);
+bool GetBinding();
+
+}
+
+#endif /* NUMA_H_ */
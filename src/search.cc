@@ -29,11 +29,16 @@
 #include "net_evaluation.h"
 #include "transposition.h"
 #include "search_thread.h"
+#include "numa.h"
 #include <cassert>
 #include <iostream>
 #include <fstream>
 #include <optional>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <mutex>
+#include <thread>
 #include <random>
 #include <tuple>
 
@@ -171,14 +176,58 @@ Score last_search_score;
 
 bool print_info = true;
 
-bool SwapToFront(std::vector<Move> &moves, const Move move) {
-  for (size_t i = 0; i < moves.size(); ++i) {
-    if (moves[i] == move) {
-      std::swap(moves[i], moves[0]);
-      return true;
+// Helper depth scheduling. Every depth counts the helpers currently searching
+// it, so helpers can avoid crowded depths without locking or scanning others.
+enum SkipPattern {
+  kSkipNone,   // Helpers search every depth
+  kSkipModulo, // Helpers search one in three crowded depths and skip ahead
+  kSkipTable,  // Helpers skip crowded depths in staggered blocks
+  kNumSkipPatterns
+};
+
+size_t multipv = 1;
+// Root moves the search is restricted to, all moves if empty.
+std::vector<Move> search_moves;
+bool root_move_stats = false;
+bool eval_stats = false;
+
+inline bool IsSearchMove(const Move move) {
+  return search_moves.empty()
+      || std::find(search_moves.begin(), search_moves.end(), move) != search_moves.end();
+}
+
+int32_t helper_skip_pattern = kSkipModulo;
+bool helper_root_split = false;
+std::array<std::atomic<int32_t>, settings::kMaxDepth + 1> threads_at_depth;
+
+constexpr std::array<Depth, 20> kSkipSize  { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+constexpr std::array<Depth, 20> kSkipPhase { 0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7 };
+
+// Returns false if helper id should skip depth. May also move depth further ahead.
+bool ScheduleHelperDepth(const int id, Depth &depth) {
+  if (helper_skip_pattern == kSkipNone) {
+    return true;
+  }
+  // The modulo rule counts helpers which are at least as deep, other patterns
+  // only those at exactly this depth.
+  size_t count = threads_at_depth[depth].load(std::memory_order_relaxed);
+  if (helper_skip_pattern == kSkipModulo) {
+    for (Depth d = depth + 1; d <= settings::kMaxDepth; ++d) {
+      count += threads_at_depth[d].load(std::memory_order_relaxed);
+    }
+  }
+  if (count < search::Threads.get_thread_count() / 2) {
+    return true;
+  }
+  if (helper_skip_pattern == kSkipModulo) {
+    if ((id % 3) != (depth % 3)) {
+      return false;
     }
+    depth = std::min(depth+1, rsearch_depth);
+    return true;
   }
-  return false;
+  const size_t idx = (id - 1) % kSkipSize.size();
+  return ((depth + kSkipPhase[idx]) / kSkipSize[idx]) % 2 == 0;
 }
 
 size_t min_ply = 0;
@@ -186,18 +235,115 @@ constexpr size_t kInfiniteNodes = 1000000000000;
 size_t max_nodes = kInfiniteNodes;
 bool fixed_search_time;
 
-Time end_time = now();
+Time search_begin = now();
+
+// Ends the search once its deadline has passed, so threads only need to check
+// Threads.end_search instead of polling the clock. While pondering there is no
+// deadline until ponderhit.
+class SearchTimer {
+ public:
+  ~SearchTimer() {
+    stop();
+  }
+
+  // The budget is kept for ponderhit, which arrives on another thread.
+  void start(const Time begin, const Milliseconds budget_) {
+    stop();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      budget = budget_;
+      deadline = begin + budget;
+      active = true;
+    }
+    thread = std::thread(&SearchTimer::run, this);
+  }
+
+  // Stops the timer without ending the search.
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      active = false;
+    }
+    cv.notify_all();
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+
+  void request_stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      pondering = false;
+      deadline = now();
+    }
+    cv.notify_all();
+  }
+
+  void set_pondering(const bool pondering_) {
+    std::lock_guard<std::mutex> lock(mutex);
+    pondering = pondering_;
+  }
+
+  bool is_pondering() const {
+    return pondering.load(std::memory_order_relaxed);
+  }
+
+  // The clock starts running at ponderhit, so the deadline is set from now.
+  void ponder_hit() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!pondering) {
+        return;
+      }
+      pondering = false;
+      deadline = now() + budget;
+    }
+    cv.notify_all();
+  }
+
+  void wait_while_pondering() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this] { return !pondering; });
+  }
+
+ private:
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (active && (pondering || now() < deadline)) {
+      if (pondering) {
+        cv.wait(lock);
+      }
+      else {
+        cv.wait_until(lock, deadline);
+      }
+    }
+    if (active) {
+      search::Threads.end_search = true;
+    }
+  }
+
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable cv;
+  Time deadline;
+  Milliseconds budget;
+  bool active = false;
+  std::atomic<bool> pondering = false;
+};
+
+SearchTimer search_timer;
+// Set if the time management would have stopped the search while pondering.
+std::atomic<bool> stop_on_ponderhit = false;
 
 inline bool finished(search::Thread &thread) {
-  if (thread.id == 0) {
+  if (thread.id == 0 && max_nodes != kInfiniteNodes) {
     if (skip_time_check <= 0) {
-      size_t current_nodes = search::Threads.get_node_count();
+      size_t current_nodes = search::Threads.get_node_count() + thread.pending_nodes;
       skip_time_check = std::min((size_t)512, max_nodes-current_nodes);
-      return end_time <= now() || max_nodes <= current_nodes
-                               || search::Threads.end_search.load(std::memory_order_relaxed);
+      return max_nodes <= current_nodes
+          || search::Threads.end_search.load(std::memory_order_relaxed);
     }
     skip_time_check--;
-    return search::Threads.end_search;
   }
   return search::Threads.end_search.load(std::memory_order_relaxed);
 }
@@ -220,7 +366,7 @@ void build_pv(Board &board, std::vector<Move> &pv) {
   OptEntry entry = table::GetEntry(board.get_hash());
 
   if (entry.has_value()) {
-    std::vector<Move> moves = board.GetMoves<kNonQuiescent>();
+    MoveList moves = board.GetMoves<kNonQuiescent>();
     for (Move move : moves) {
       if (move == entry->get_best_move()) {
         return build_pv(board, pv, move);
@@ -248,8 +394,8 @@ inline bool is_null_move_allowed(const Score &eval, const Score &beta,
 
 namespace search {
 
-std::vector<Move> GetSortedMovesML(Board &board) {
-  std::vector<Move> moves = board.GetMoves<kNonQuiescent>();
+MoveList GetSortedMovesML(Board &board) {
+  MoveList moves = board.GetMoves<kNonQuiescent>();
   Threads.main_thread->board.SetToSamePosition(board);
   move_order::SortML(moves, *Threads.main_thread);
   return moves;
@@ -263,7 +409,7 @@ size_t Perft(Board &board, Depth depth) {
     return board.GetMoves<kNonQuiescent>().size();
   }
   size_t perft_sum = 0;
-  std::vector<Move> moves = board.GetMoves<kNonQuiescent>();
+  MoveList moves = board.GetMoves<kNonQuiescent>();
   for (Move move : moves) {
     board.Make(move);
     perft_sum += Perft(board, depth-1);
@@ -321,9 +467,9 @@ Score QuiescentSearch(Thread &t, Score alpha, const Score beta) {
   }
 
   //Get moves
-  std::vector<Move> moves = t.board.GetMoves<kQuiescent>();
+  move_order::QuiescentMovePicker picker(t, entry.has_value() ? entry->get_best_move() : kNullMove);
 
-  if (moves.size() == 0) {
+  if (picker.empty()) {
     if (in_check) {
       //In check all moves are generated, so if we have no moves in check it is mate.
       return GetMatedOnMoveScore(t.board.get_num_made_moves());
@@ -331,20 +477,8 @@ Score QuiescentSearch(Thread &t, Score alpha, const Score beta) {
     return lower_bound_score;
   }
 
-  //Move best_move = 0;
-
-  //Sort move list
-  if (entry.has_value()) {
-    move_order::Sort(moves, t, entry->get_best_move());
-    //SortMovesML(moves, board, entry.best_move);
-  }
-  else {
-    move_order::Sort(moves, t, 0);
-    //SortMovesML(moves, board, 0);
-  }
-
   //Move loop
-  for (Move move : moves) {
+  for (Move move = picker.next(); move != kNullMove; move = picker.next()) {
     //SEE pruning
     //Exception for checking moves: -16.03 +/- 10.81
     if (!in_check && GetMoveType(move) != kEnPassant && !t.board.NonNegativeSEE(move)) {
@@ -353,6 +487,7 @@ Score QuiescentSearch(Thread &t, Score alpha, const Score beta) {
 
     //Make move, search and unmake
     t.board.Make(move);
+    table::Prefetch(t.board.get_hash());
     Score score = -QuiescentSearch(t, -beta, -alpha);
     t.board.UnMake();
 
@@ -380,7 +515,7 @@ inline NScore get_futility_margin(Depth depth, bool improving) {
   return kFutileMargin[depth] + kFutilityImproving * depth * improving;
 }
 
-void update_counter_move_history(Thread &t, const std::vector<Move> &quiets, const Depth depth) {
+void update_counter_move_history(Thread &t, const MoveList &quiets, const Depth depth) {
   if (t.board.get_num_made_moves() == 0 || t.board.get_last_move() == kNullMove) {
     return;
   }
@@ -491,6 +626,15 @@ inline void update_counter_moves(Thread &t, const Move move) {
   }
 }
 
+// Reports the root move being searched once a search has run for a while, as is
+// done in SF.
+void PrintCurrentMove(const Depth depth, const Move move, const size_t move_number) {
+  if (print_info && now() - search_begin > Milliseconds(3000)) {
+    std::cout << "info depth " << depth << " currmove " << parse::MoveToString(move)
+              << " currmovenumber " << move_number << std::endl;
+  }
+}
+
 template<NodeType node_type>
 Score AlphaBeta(Thread &t, Score alpha, const Score beta, Depth depth, Move exclude_move = kNullMove) {
   assert(alpha.is_valid());
@@ -575,6 +719,7 @@ Score AlphaBeta(Thread &t, Score alpha, const Score beta, Depth depth, Move excl
     if (is_null_move_allowed(eval_estimate, beta, t.board, depth)) {
       t.set_move(kNullMove);
       t.board.Make(kNullMove);
+      table::Prefetch(t.board.get_hash());
       const Depth R = (kNMPBase + depth * kNMPScale) / 128;
       Score score = -AlphaBeta<NodeType::kNW>(t, -beta, -alpha,
                                               depth - R);
@@ -592,15 +737,6 @@ Score AlphaBeta(Thread &t, Score alpha, const Score beta, Depth depth, Move excl
     depth--;
   }
 
-  //Get move list and return result if there are no legal moves
-  std::vector<Move> moves = t.board.GetMoves<kNonQuiescent>();
-  if (moves.size() == 0) {
-    if (in_check) {
-      return GetMatedOnMoveScore(t.board.get_num_made_moves());
-    }
-    return draw_score[t.board.get_turn()];
-  }
-
   Move tt_entry = kNullMove;
   if (entry.has_value()) {
     tt_entry = entry->get_best_move();
@@ -608,20 +744,39 @@ Score AlphaBeta(Thread &t, Score alpha, const Score beta, Depth depth, Move excl
   if (is_root) {
     tt_entry = t.best_root_move;
   }
+  Move best_local_move = tt_entry;
 
-  bool moves_sorted = false, swapped = false;
-  if (tt_entry != kNullMove) {
-    swapped = SwapToFront(moves, tt_entry);
-    assert(!swapped || tt_entry == moves[0]);
-  }
-  if (!swapped) {
-    move_order::SortML(moves, t, tt_entry);
-    moves_sorted = true;
-  }
+  // Moves are generated lazily in NW nodes, a cutoff by the TT move saves
+  // generating the others. PV nodes need the number of moves right away.
+  move_order::MovePicker picker(t, tt_entry);
+  const bool partial_root = is_root && (!t.excluded_root_moves.empty() || !search_moves.empty());
+  size_t num_moves = 0;
+  if (node_type == NodeType::kPV) {
+    MoveList &moves = picker.generate();
+    if (moves.size() == 0) {
+      if (in_check) {
+        return GetMatedOnMoveScore(t.board.get_num_made_moves());
+      }
+      return draw_score[t.board.get_turn()];
+    }
 
-  Move best_local_move = tt_entry;
-  if (node_type == NodeType::kPV && moves.size() == 1) {
-    depth++;
+    // Root moves outside of searchmoves or of better MultiPV lines are left out.
+    // The remaining root moves only give a partial result, which is not stored
+    // in the TT.
+    if (partial_root) {
+      moves.erase(std::remove_if(moves.begin(), moves.end(), [&t](const Move move) {
+        return !IsSearchMove(move)
+            || std::find(t.excluded_root_moves.begin(), t.excluded_root_moves.end(), move)
+                != t.excluded_root_moves.end();
+      }), moves.end());
+    }
+    num_moves = moves.size();
+    if (num_moves == 1 && !partial_root) {
+      depth++;
+    }
+  }
+  if (is_root) {
+    picker.set_rotation(t.root_split_offset);
   }
 
   //Init checking squares for efficient detection of checking moves.
@@ -630,22 +785,18 @@ Score AlphaBeta(Thread &t, Score alpha, const Score beta, Depth depth, Move excl
   std::array<BitBoard, 6> checking_squares = t.board.GetDirectCheckingSquares();
 
   Score lower_bound_score = GetMatedOnMoveScore(t.board.get_num_made_moves());
-  std::vector<Move> quiets;
+  MoveList quiets;
   Score alpha_nw = alpha.get_next_score();
   //Move loop
-  for (size_t i = 0; i < moves.size(); ++i) {
-    if (i == 1 && !moves_sorted) {
-      move_order::SortML(moves, t, tt_entry, 1);
-      moves_sorted = true;
-    }
-    const Move move = moves[i];
+  size_t i = 0;
+  for (Move move = picker.next(); move != kNullMove; move = picker.next(), ++i) {
     if (move == exclude_move) {
       continue;
     }
     
     Depth e = 0;// Extensions
     if (i == 0 && entry.has_value() && !is_root
-        && singular_conditions_met(node_type, t, depth, entry, moves.size())) {
+        && singular_conditions_met(node_type, t, depth, entry, num_moves)) {
       const auto [rAlpha, rBeta, rDepth] = get_singular_bounds(t, depth, entry);
       Score score = AlphaBeta<NodeType::kNW>(t, rAlpha, rBeta, rDepth, tt_entry);
       if (score <= rAlpha) {
@@ -696,9 +847,15 @@ Score AlphaBeta(Thread &t, Score alpha, const Score beta, Depth depth, Move excl
       quiets.emplace_back(move);
     }
 
+    const size_t nodes_before = t.get_local_nodes();
+    if (is_root && t.id == 0) {
+      PrintCurrentMove(depth, move, i + 1);
+    }
+
     //Make moves, search and unmake
     t.set_move(move);
     t.board.Make(move);
+    table::Prefetch(t.board.get_hash());
     Score score;
     if (i == 0) {
       //First move gets searched at full depth and window
@@ -715,6 +872,9 @@ Score AlphaBeta(Thread &t, Score alpha, const Score beta, Depth depth, Move excl
     }
     assert(score.is_valid());
     t.board.UnMake();
+    if (is_root && t.id == 0) {
+      t.add_root_move_nodes(move, t.get_local_nodes() - nodes_before);
+    }
 
     //Ensure we still have time and our score was not prematurely terminated
     if (finished(t)) {
@@ -728,7 +888,9 @@ Score AlphaBeta(Thread &t, Score alpha, const Score beta, Depth depth, Move excl
         return score;
       }
       
-      table::SaveEntry(t.board, move, score, depth);
+      if (!partial_root) {
+        table::SaveEntry(t.board, move, score, depth);
+      }
       update_counter_moves(t, move);
       if (GetMoveType(move) < kCapture) {
         update_counter_move_history(t, quiets, depth);
@@ -762,17 +924,27 @@ Score AlphaBeta(Thread &t, Score alpha, const Score beta, Depth depth, Move excl
       lower_bound_score = score;
     }
   }
+
+  //Return result if there are no legal moves
+  if (picker.get_num_picked() == 0) {
+    if (in_check) {
+      return GetMatedOnMoveScore(t.board.get_num_made_moves());
+    }
+    return draw_score[t.board.get_turn()];
+  }
   
   if (node_type != NodeType::kNW && alpha > original_alpha) {
     assert(best_local_move != kNullMove);
     assert(exclude_move == kNullMove);
     // We should save any best move which has improved alpha.
-    table::SavePVEntry(t.board, best_local_move, lower_bound_score, depth);
+    if (!partial_root) {
+      table::SavePVEntry(t.board, best_local_move, lower_bound_score, depth);
+    }
     if (!in_check && GetMoveType(best_local_move) < kCapture) {
       t.update_error_history(lower_bound_score, depth);
     }
   }
-  else if (!exclude_move) {
+  else if (!exclude_move && !partial_root) {
     table::SaveEntry(t.board, best_local_move, lower_bound_score, depth, kUpperBound);
     if (!in_check && GetMoveType(best_local_move) < kCapture && raw_static_eval > lower_bound_score) {
       t.update_error_history(lower_bound_score, depth);
@@ -783,7 +955,7 @@ Score AlphaBeta(Thread &t, Score alpha, const Score beta, Depth depth, Move excl
 }
 
 inline Score PVS(Thread &t, Depth current_depth, const std::vector<Score> &previous_scores) {
-  if (current_depth <= 4) {
+  if (current_depth <= 4 || previous_scores.empty()) {
     Score score = AlphaBeta<NodeType::kPV>(t, kMinScore, kMaxScore, current_depth);
     if (t.id == 0 && !finished(t)) {
       last_search_score = score;
@@ -833,15 +1005,19 @@ inline Score PVS(Thread &t, Depth current_depth, const std::vector<Score> &previ
 }
 
 void PrintUCIInfoString(Thread &t, const Depth depth, const Time &begin,
-                        const Time &end, const Score &score, const Move best_move) {
-  std::vector<Move> pv;
-  build_pv(t.board, pv, best_move);
+                        const Time &end, const Score &score, const std::vector<Move> &pv,
+                        const size_t multipv = 0) {
+  t.publish_nodes();
   size_t node_count = Threads.get_node_count();
   auto time_used = std::chrono::duration_cast<Milliseconds>(end-begin);
   if (print_info) {
     std::cout << "info"  
         << " depth "    << depth
-        << " seldepth " << (Threads.get_max_depth() - t.board.get_num_made_moves())
+        << " seldepth " << (Threads.get_max_depth() - t.board.get_num_made_moves());
+    if (multipv > 0) {
+      std::cout << " multipv " << multipv;
+    }
+    std::cout
         << " time "     << time_used.count()
         << " nodes "    << node_count << " nps " << ((1000*node_count) / (time_used.count()+1));
 
@@ -883,8 +1059,104 @@ void PrintUCIInfoString(Thread &t, const Depth depth, const Time &begin,
   }
 }
 
+// Debug statistics of the evaluation, only printed with the EvalStats option.
+void PrintUCIStatStrings() {
+  if (print_info && eval_stats) {
+    size_t eval_cache_probes = Threads.get_eval_cache_probes();
+    if (eval_cache_probes > 0) {
+      size_t eval_cache_hits = Threads.get_eval_cache_hits();
+      std::cout << "info string evalcache hits " << eval_cache_hits
+                << " probes " << eval_cache_probes
+                << " hitrate " << ((100 * eval_cache_hits) / eval_cache_probes) << "%" << std::endl;
+    }
+    size_t from_scratch = Threads.get_eval_updates(kEvalFromScratch);
+    size_t incremental = Threads.get_eval_updates(kEvalIncremental);
+    size_t chained = Threads.get_eval_updates(kEvalChained);
+    if (from_scratch + incremental + chained > 0) {
+      std::cout << "info string evalupdates scratch " << from_scratch
+                << " incremental " << incremental
+                << " chained " << chained << std::endl;
+    }
+  }
+}
+
+// Searches the best root moves one after another, every line excluding the moves
+// of the lines before it. The TT is shared between lines, so later lines are
+// much cheaper than separate searches.
+void SearchPVLines(Thread &t, const Depth depth) {
+  MoveList moves = t.board.GetMoves<kNonQuiescent>();
+  const size_t num_lines = std::min(multipv, (size_t)std::count_if(moves.begin(), moves.end(),
+                                                                  IsSearchMove));
+  std::vector<RootMove> lines;
+  for (size_t k = 0; k < num_lines; ++k) {
+    // Each line starts with the move it had in the last iteration, unless that
+    // move has already been taken by a better line.
+    t.best_root_move = kNullMove;
+    std::vector<Score> previous_scores;
+    if (k < t.pv_lines.size()) {
+      previous_scores.emplace_back(t.pv_lines[k].score);
+      for (const RootMove &line : t.pv_lines) {
+        if (std::find(t.excluded_root_moves.begin(), t.excluded_root_moves.end(), line.move)
+            == t.excluded_root_moves.end()) {
+          t.best_root_move = line.move;
+          break;
+        }
+      }
+    }
+    Score score = PVS(t, depth, previous_scores);
+    if (finished(t)) {
+      break;
+    }
+    RootMove line { t.best_root_move, score, depth, {} };
+    build_pv(t.board, line.pv, line.move);
+    lines.emplace_back(line);
+    t.excluded_root_moves.emplace_back(line.move);
+  }
+  t.excluded_root_moves.clear();
+
+  // Lines the search did not get to keep their result from the last iteration.
+  for (const RootMove &line : t.pv_lines) {
+    if (lines.size() >= num_lines) {
+      break;
+    }
+    if (std::find_if(lines.begin(), lines.end(), [&line](const RootMove &other) {
+          return other.move == line.move; }) == lines.end()) {
+      lines.emplace_back(line);
+    }
+  }
+  std::stable_sort(lines.begin(), lines.end(), [](const RootMove &a, const RootMove &b) {
+    return a.score > b.score;
+  });
+  t.pv_lines = lines;
+  if (!lines.empty()) {
+    t.best_root_move = lines[0].move;
+    last_search_score = lines[0].score;
+  }
+}
+
+// Summarizes how the nodes of the main thread were spread over the root moves.
+void PrintRootMoveStats(const Thread &t) {
+  if (!print_info) {
+    return;
+  }
+  std::vector<RootMove> root_moves = t.root_moves;
+  std::stable_sort(root_moves.begin(), root_moves.end(), [](const RootMove &a, const RootMove &b) {
+    return a.nodes > b.nodes;
+  });
+  size_t total = 0;
+  for (const RootMove &root_move : root_moves) {
+    total += root_move.nodes;
+  }
+  for (const RootMove &root_move : root_moves) {
+    std::cout << "info string rootmove " << parse::MoveToString(root_move.move)
+              << " nodes " << root_move.nodes
+              << " share " << (total ? (100 * root_move.nodes) / total : 0) << "%" << std::endl;
+  }
+}
+
 void Thread::search() {
-  const Time begin = end_time-rsearch_duration;
+  const Time begin = search_begin;
+  numa::BindThisThread(id);
   // Thread data is initialized here to improve NUMA performance
   if (!initialized) {
     clear_killers_and_counter_moves();
@@ -892,6 +1164,9 @@ void Thread::search() {
   double time_factor = 1.0;
   current_depth = 1;
   root_height = board.get_num_made_moves();
+  excluded_root_moves.clear();
+  pv_lines.clear();
+  root_moves.clear();
 
   Score score = net_evaluation::ScoreBoard(board);
   set_static_score(score);
@@ -904,27 +1179,25 @@ void Thread::search() {
       break;
     }
 
-    if (id != 0 && depth > 4) {
-      static std::mutex mutex;
-      std::lock_guard<std::mutex> lock(mutex);
-
-      size_t count = 0;
-      for (Thread* t : Threads.helpers) {
-        if (depth <= t->current_depth) {
-          count++;
-        }
-      }
-      if (count >= Threads.get_thread_count() / 2) {
-        if ((id % 3) != (depth % 3)) {
-          continue;
-        }
-        depth = std::min(depth+1, rsearch_depth);
-      }
+    if (id != 0 && depth > 4 && !ScheduleHelperDepth(id, depth)) {
+      continue;
     }
 
     current_depth = depth;
 
-    score = PVS(*this, current_depth, previous_scores);
+    if (id != 0) {
+      threads_at_depth[depth].fetch_add(1, std::memory_order_relaxed);
+    }
+    if (id == 0 && multipv > 1) {
+      SearchPVLines(*this, current_depth);
+      score = last_search_score;
+    }
+    else {
+      score = PVS(*this, current_depth, previous_scores);
+    }
+    if (id != 0) {
+      threads_at_depth[depth].fetch_sub(1, std::memory_order_relaxed);
+    }
     
     previous_scores.emplace_back(score);
     
@@ -934,15 +1207,31 @@ void Thread::search() {
       }
       Time end = now();
 
-      PrintUCIInfoString(*this, current_depth, begin, end, last_search_score, best_root_move);
+      if (multipv > 1) {
+        for (size_t k = 0; k < pv_lines.size(); ++k) {
+          PrintUCIInfoString(*this, pv_lines[k].depth, begin, end, pv_lines[k].score,
+                             pv_lines[k].pv, k + 1);
+        }
+      }
+      else {
+        std::vector<Move> pv;
+        build_pv(board, pv, best_root_move);
+        PrintUCIInfoString(*this, current_depth, begin, end, last_search_score, pv);
+      }
+      PrintUCIStatStrings();
 
       auto time_used = std::chrono::duration_cast<Milliseconds>(end-begin);
       if (!fixed_search_time) {
         if (last_best == best_root_move) {
           time_factor = std::max(time_factor * 0.9, 0.5);
           if (time_used.count() > (rsearch_duration.count() * time_factor)) {
-            end_time = now();
-            return;
+            if (search_timer.is_pondering()) {
+              stop_on_ponderhit = true;
+            }
+            else {
+              Threads.end_search = true;
+              return;
+            }
           }
         }
         else {
@@ -958,7 +1247,7 @@ Move RootSearch(Board &board, Depth depth, Milliseconds duration = Milliseconds(
   Threads.is_searching = true;
   rsearch_depth = std::min(depth, settings::kMaxDepth);
   rsearch_duration = duration;
-  end_time = now()+rsearch_duration;
+  search_begin = now();
   table::UpdateGeneration();
   if (armageddon) {
     net_evaluation::SetContempt(kWhite, 60);
@@ -971,8 +1260,11 @@ Move RootSearch(Board &board, Depth depth, Milliseconds duration = Milliseconds(
   min_ply = board.get_num_made_moves();
   Threads.reset_node_count();
   Threads.reset_depths();
+  for (std::atomic<int32_t> &count : threads_at_depth) {
+    count = 0;
+  }
   skip_time_check = std::min((size_t)256, max_nodes);
-  std::vector<Move> moves = board.GetMoves<kNonQuiescent>();
+  MoveList moves = board.GetMoves<kNonQuiescent>();
   if (moves.size() == 0) {
     std::cout << "info depth 0 score";
     if (board.InCheck()) {
@@ -990,6 +1282,8 @@ Move RootSearch(Board &board, Depth depth, Milliseconds duration = Milliseconds(
     std::cout << std::endl;
     return kNullMove;
   }
+  moves.erase(std::remove_if(moves.begin(), moves.end(),
+                             [](const Move move) { return !IsSearchMove(move); }), moves.end());
   if (moves.size() == 1 && !fixed_search_time) {
     return moves[0];
   }
@@ -998,6 +1292,11 @@ Move RootSearch(Board &board, Depth depth, Milliseconds duration = Milliseconds(
   if (entry.has_value()) {
     tt_move = entry->get_best_move();
   }
+  // The stored move may be excluded by searchmoves, it would then be reported
+  // if the search ends before any root move was searched.
+  if (!IsSearchMove(tt_move)) {
+    tt_move = moves[0];
+  }
   Threads.main_thread->board.SetToSamePosition(board);
   Threads.main_thread->root_height = board.get_num_made_moves();
   Threads.main_thread->max_depth = board.get_num_made_moves();
@@ -1005,21 +1304,30 @@ Move RootSearch(Board &board, Depth depth, Milliseconds duration = Milliseconds(
   Threads.main_thread->best_root_move = tt_move;
   
   Threads.end_search = false;
+  search_timer.start(search_begin, rsearch_duration);
   
   for (Thread* t : Threads.helpers) {
     t->board.SetToSamePosition(board);
     t->root_height = board.get_num_made_moves();
     t->best_root_move = tt_move;
+    t->root_split_offset = (helper_root_split && t->id % 2 == 0) ? t->id / 2 : 0;
     t->max_depth = t->board.get_num_made_moves();
     t->start_searching();
   }
   
+  const allocations::Counts allocations_before = allocations::GetThreadCounts();
   Threads.main_thread->search();
+  Threads.main_thread->search_allocations = allocations::GetThreadCounts() - allocations_before;
+  Threads.main_thread->publish_nodes();
   Threads.end_search = true;
   
   for (Thread* t : Threads.helpers) {
     t->wait_for_completion();
   }
+  search_timer.stop();
+  if (root_move_stats) {
+    PrintRootMoveStats(*Threads.main_thread);
+  }
   
   return Threads.main_thread->best_root_move;
 }
@@ -1061,7 +1369,37 @@ Move NodeSearch(Board board, size_t num_nodes) {
 }
 
 void end_search() {
-  end_time = now();
+  Threads.end_search = true;
+  search_timer.request_stop();
+}
+
+// Called on the UCI thread before the search thread starts, so a quick ponderhit
+// can not see the stop request of the previous search.
+void set_pondering(bool pondering) {
+  stop_on_ponderhit = false;
+  search_timer.set_pondering(pondering);
+}
+
+void ponder_hit() {
+  if (stop_on_ponderhit) {
+    end_search();
+  }
+  else {
+    search_timer.ponder_hit();
+  }
+}
+
+void wait_for_ponderhit() {
+  search_timer.wait_while_pondering();
+}
+
+Move GetPonderMove(Board board, const Move best_move) {
+  if (best_move == kNullMove) {
+    return kNullMove;
+  }
+  std::vector<Move> pv;
+  build_pv(board, pv, best_move);
+  return pv.size() > 1 ? pv[1] : kNullMove;
 }
 
 void clear_killers_and_counter_moves() {
@@ -1085,6 +1423,30 @@ void SetContempt(int32_t contempt_) {
   contempt = contempt_;
 }
 
+void SetSearchMoves(const std::vector<Move> &moves) {
+  search_moves = moves;
+}
+
+void SetRootMoveStats(bool enabled) {
+  root_move_stats = enabled;
+}
+
+void SetEvalStats(bool enabled) {
+  eval_stats = enabled;
+}
+
+void SetMultiPV(int32_t num_lines) {
+  multipv = std::max(num_lines, 1);
+}
+
+void SetHelperSkipPattern(int32_t pattern) {
+  helper_skip_pattern = std::min(std::max(pattern, 0), (int32_t)kNumSkipPatterns - 1);
+}
+
+void SetHelperRootSplit(bool split) {
+  helper_root_split = split;
+}
+
 #ifdef TUNE
 
 #define SETTER(x) \
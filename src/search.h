@@ -48,14 +48,32 @@ Score get_last_search_score();
 size_t get_num_nodes();
 void set_print_info(bool print_info);
 void end_search();
+// A search started while pondering has no time limit until ponder_hit is called.
+// Time spent pondering still counts towards the decision to stop early.
+void set_pondering(bool pondering);
+void ponder_hit();
+void wait_for_ponderhit();
+// Returns the expected reply to best_move from the principal variation.
+Move GetPonderMove(Board board, const Move best_move);
 Board get_sampled_board();
-std::vector<Move> GetSortedMovesML(Board &board);
+MoveList GetSortedMovesML(Board &board);
 
 void clear_killers_and_counter_moves();
 
 void SetArmageddon(bool armageddon);
 void SetContempt(int32_t contempt);
 void SetUCIShowWDL(bool show_wdl);
+void SetMultiPV(int32_t num_lines);
+// Restricts the root moves of the following searches, an empty list allows all.
+void SetSearchMoves(const std::vector<Move> &moves);
+// Prints the nodes spent on each root move after a search.
+void SetRootMoveStats(bool enabled);
+// Prints eval cache and network update counts after each iteration.
+void SetEvalStats(bool enabled);
+// 0: helpers search every depth, 1: modulo three skipping, 2: staggered skip table.
+void SetHelperSkipPattern(int32_t pattern);
+// Every second helper starts on a different root move after the first.
+void SetHelperRootSplit(bool split);
 
 #ifdef TUNE
 #define OPTION(x) \
@@ -27,6 +27,8 @@
 
 #include "search_thread.h"
 #include "general/types.h"
+#include "numa.h"
+#include <new>
 #include <random>
 #include <algorithm>
 #include <iostream>
@@ -59,6 +61,13 @@ Thread::Thread() {
   run = false;
   exit = false;
   searching = false;
+  eval_cache_probes = 0;
+  eval_cache_hits = 0;
+  histories_allocation = large_pages::Allocate(sizeof(LargeHistories));
+  histories = new (histories_allocation.ptr) LargeHistories;
+  for (std::atomic<size_t> &count : eval_updates) {
+    count = 0;
+  }
 }
 
 Thread::~Thread() {
@@ -71,6 +80,7 @@ Thread::~Thread() {
     cv.notify_one();
     native_thread.join();
   }
+  large_pages::Free(histories_allocation);
 }
 
 void Thread::launch() {
@@ -90,7 +100,10 @@ void Thread::idle_loop() {
     run = false; // Consume the run signal
     lock.unlock();
 
+    const allocations::Counts allocations_before = allocations::GetThreadCounts();
     search();
+    search_allocations = allocations::GetThreadCounts() - allocations_before;
+    publish_nodes();
 
     lock.lock();
     searching = false;
@@ -110,6 +123,17 @@ void Thread::wait_for_completion() {
   cv.wait(lock, [this] { return !searching && !run; });
 }
 
+void Thread::set_eval_cache_size(size_t num_entries) {
+  assert((num_entries & (num_entries - 1)) == 0);
+  eval_cache.resize(num_entries);
+  eval_cache.shrink_to_fit();
+  clear_eval_cache();
+}
+
+void Thread::clear_eval_cache() {
+  std::fill(eval_cache.begin(), eval_cache.end(), EvalCacheEntry{ 0, kNoScore });
+}
+
 void Thread::set_move(Move move) {
   Depth height = get_height();
   if (move == kNullMove) {
@@ -147,16 +171,31 @@ inline float sclamp(const float value, const float lower, const float upper) {
   return std::min(std::max(value, lower), upper);
 }
 
+inline float load_entry(const float &entry) {
+  return entry;
+}
+
+inline float load_entry(const std::atomic<float> &entry) {
+  return entry.load(std::memory_order_relaxed);
+}
+
 inline void gravity_float_update(float &entry, float value, float leak) {
   entry += value - entry * (std::abs(value) + leak) / 1024;
 }
 
-void accumulate_errors(const ErrorHistory &history, const HashType error_hash,
+inline void gravity_float_update(std::atomic<float> &entry, float value, float leak) {
+  float updated = load_entry(entry);
+  gravity_float_update(updated, value, leak);
+  entry.store(updated, std::memory_order_relaxed);
+}
+
+template<typename History>
+void accumulate_errors(const History &history, const HashType error_hash,
                        float &win_error, float &loss_error, float scale=1.0) {
   size_t idx = error_hash % kErrorHistorySize;
   
-  win_error  += history[idx][0] * scale;
-  loss_error += history[idx][1] * scale;
+  win_error  += load_entry(history[idx][0]) * scale;
+  loss_error += load_entry(history[idx][1]) * scale;
 }
 
 Score Thread::adjust_static_eval(const Score static_eval) const {
@@ -165,16 +204,27 @@ Score Thread::adjust_static_eval(const Score static_eval) const {
   
   float win_error = 0, loss_error = 0;
   
-  accumulate_errors(pawn_error_history, board.get_pawn_hash(),
-                    win_error, loss_error, kPawnCorrectionScale);
-  accumulate_errors(major_error_history, board.get_major_hash(),
-                    win_error, loss_error, kMajorCorrectionScale);
-  accumulate_errors(minor_error_history, board.get_major_hash() >> 32,
-                    win_error, loss_error, kMinorCorrectionScale);
+  if (Threads.shared_histories) {
+    const SharedHistories &shared = *Threads.shared_histories;
+    accumulate_errors(shared.pawn_error_history, board.get_pawn_hash(),
+                      win_error, loss_error, kPawnCorrectionScale);
+    accumulate_errors(shared.major_error_history, board.get_major_hash(),
+                      win_error, loss_error, kMajorCorrectionScale);
+    accumulate_errors(shared.minor_error_history, board.get_major_hash() >> 32,
+                      win_error, loss_error, kMinorCorrectionScale);
+  }
+  else {
+    accumulate_errors(histories->pawn_error_history, board.get_pawn_hash(),
+                      win_error, loss_error, kPawnCorrectionScale);
+    accumulate_errors(histories->major_error_history, board.get_major_hash(),
+                      win_error, loss_error, kMajorCorrectionScale);
+    accumulate_errors(histories->minor_error_history, board.get_major_hash() >> 32,
+                      win_error, loss_error, kMinorCorrectionScale);
+  }
   for (int e_idx = 0; e_idx < kNumRngHash; ++e_idx) {
     for (int shift = 0; shift < 4; ++shift) {
       HashType rng_hash = (board.get_rng_hash(e_idx) >> (shift * 16)) & 0xFFFF;
-      accumulate_errors(rng_error_history[e_idx][shift], rng_hash,
+      accumulate_errors(histories->rng_error_history[e_idx][shift], rng_hash,
                         win_error, loss_error, kRNGCorrectionScale);
     }
   }
@@ -202,7 +252,8 @@ Score Thread::adjust_static_eval(const Score static_eval) const {
   return WDLScore::from_pct(win, loss);
 }
 
-void update_specific_history(ErrorHistory &history, const HashType error_hash,
+template<typename History>
+void update_specific_history(History &history, const HashType error_hash,
                              float win_val, float loss_val, float leak) {
   size_t idx = error_hash % kErrorHistorySize;
 
@@ -232,13 +283,21 @@ void Thread::update_error_history(const Score eval, Depth depth) {
   // constexpr float kBaseLeak = 1.0f;
   float leak = kCorrectionLeakScale * static_cast<float>(std::min(depth, 16));
   
-  update_specific_history(pawn_error_history, board.get_pawn_hash(), win_val, loss_val, leak);
-  update_specific_history(major_error_history, board.get_major_hash(), win_val, loss_val, leak);
-  update_specific_history(minor_error_history, board.get_major_hash() >> 32, win_val, loss_val, leak);
+  if (Threads.shared_histories) {
+    SharedHistories &shared = *Threads.shared_histories;
+    update_specific_history(shared.pawn_error_history, board.get_pawn_hash(), win_val, loss_val, leak);
+    update_specific_history(shared.major_error_history, board.get_major_hash(), win_val, loss_val, leak);
+    update_specific_history(shared.minor_error_history, board.get_major_hash() >> 32, win_val, loss_val, leak);
+  }
+  else {
+    update_specific_history(histories->pawn_error_history, board.get_pawn_hash(), win_val, loss_val, leak);
+    update_specific_history(histories->major_error_history, board.get_major_hash(), win_val, loss_val, leak);
+    update_specific_history(histories->minor_error_history, board.get_major_hash() >> 32, win_val, loss_val, leak);
+  }
   for (int e_idx = 0; e_idx < kNumRngHash; ++e_idx) {
     for (int shift = 0; shift < 4; ++shift) {
       HashType rng_hash = (board.get_rng_hash(e_idx) >> (shift * 16)) & 0xFFFF;
-      update_specific_history(rng_error_history[e_idx][shift], rng_hash, win_val, loss_val, leak);
+      update_specific_history(histories->rng_error_history[e_idx][shift], rng_hash, win_val, loss_val, leak);
     }
   }
 }
@@ -257,17 +316,17 @@ template<int moves_ago>
 int32_t Thread::get_continuation_score(const PieceType opp_piecetype, const Square opp_des,
                       const PieceType piecetype, const Square des) const {
   const int idx = moves_ago > 2 ? moves_ago - 2 : moves_ago - 1;
-  assert(idx >= 0 && idx < continuation_history.size());
-  return continuation_history[idx][opp_piecetype][opp_des][piecetype][des];
+  assert(idx >= 0 && idx < histories->continuation_history.size());
+  return histories->continuation_history[idx][opp_piecetype][opp_des][piecetype][des];
 }
 
 template<int moves_ago>
 void Thread::update_continuation_score(const PieceType opp_piecetype, const Square opp_des,
                        const PieceType piecetype, const Square des, const int32_t score) {
   const int idx = moves_ago > 2 ? moves_ago - 2 : moves_ago - 1;
-  assert(idx >= 0 && idx < continuation_history.size());
-  continuation_history[idx][opp_piecetype][opp_des][piecetype][des] += 32 * score
-      - continuation_history[idx][opp_piecetype][opp_des][piecetype][des]
+  assert(idx >= 0 && idx < histories->continuation_history.size());
+  histories->continuation_history[idx][opp_piecetype][opp_des][piecetype][des] += 32 * score
+      - histories->continuation_history[idx][opp_piecetype][opp_des][piecetype][des]
                     * std::abs(score) / 512;
 }
 
@@ -283,14 +342,45 @@ int32_t Thread::get_continuation_score(const Move move) const {
   const PieceType piece_type = GetPieceType(board.get_piece(GetMoveSource(move)));
   const Square des = GetMoveDestination(move);
   const int idx = moves_ago > 2 ? moves_ago - 2 : moves_ago - 1;
-  assert(idx >= 0 && idx < continuation_history.size());
-  return continuation_history[idx][pt_and_des.pt][pt_and_des.des][piece_type][des];
+  assert(idx >= 0 && idx < histories->continuation_history.size());
+  return histories->continuation_history[idx][pt_and_des.pt][pt_and_des.des][piece_type][des];
+}
+
+void SharedHistories::clear() {
+  for (SharedErrorHistory *history : { &pawn_error_history, &major_error_history,
+                                       &minor_error_history }) {
+    for (auto &entry : *history) {
+      entry[0].store(0, std::memory_order_relaxed);
+      entry[1].store(0, std::memory_order_relaxed);
+    }
+  }
 }
 
 ThreadPool::ThreadPool() {
   main_thread = new Thread();
   main_thread->id = 0;
   is_searching = false;
+  shared_histories = nullptr;
+  set_eval_cache_size(settings::kDefaultEvalCacheMB);
+}
+
+ThreadPool::~ThreadPool() {
+  set_shared_error_histories(false);
+}
+
+void ThreadPool::set_shared_error_histories(bool enabled) {
+  if (enabled == (shared_histories != nullptr)) {
+    return;
+  }
+  if (enabled) {
+    shared_histories_allocation = large_pages::Allocate(sizeof(SharedHistories));
+    shared_histories = new (shared_histories_allocation.ptr) SharedHistories;
+    shared_histories->clear();
+  }
+  else {
+    shared_histories = nullptr;
+    large_pages::Free(shared_histories_allocation);
+  }
 }
 
 void ThreadPool::set_num_threads(size_t num_threads) {
@@ -299,8 +389,17 @@ void ThreadPool::set_num_threads(size_t num_threads) {
 
   //Create new threads if we have too few
   while(helpers.size() < num_helpers) {
-    helpers.push_back(new Thread());
-    helpers.back()->id = helpers.size();
+    // Allocate the thread data from a thread bound to the node the helper will
+    // run on, so it is placed in local memory.
+    const size_t id = helpers.size() + 1;
+    Thread *helper;
+    std::thread([&helper, id]() {
+      numa::BindThisThread(id);
+      helper = new Thread();
+    }).join();
+    helpers.push_back(helper);
+    helpers.back()->id = id;
+    helpers.back()->set_eval_cache_size(eval_cache_entries);
     helpers.back()->launch();
   }
 
@@ -320,6 +419,9 @@ void ThreadPool::clear_killers_and_countermoves() {
   if (main_thread->initialized) {
     main_thread->clear_killers_and_counter_moves();
   }
+  if (shared_histories) {
+    shared_histories->clear();
+  }
 }
 
 void ThreadPool::reset_depths() {
@@ -333,7 +435,7 @@ size_t ThreadPool::get_thread_count() const {
   return helpers.size() + 1;
 }
 size_t ThreadPool::get_node_count() const {
-  size_t sum = main_thread->nodes;
+  size_t sum = main_thread->nodes.load(std::memory_order_relaxed);
   for (Thread* helper : helpers) {
     sum += helper->nodes.load(std::memory_order_relaxed);
   }
@@ -353,9 +455,68 @@ size_t ThreadPool::get_max_depth() const {
 
 void ThreadPool::reset_node_count() {
   main_thread->nodes = 0;
+  main_thread->pending_nodes = 0;
+  main_thread->eval_cache_probes = 0;
+  main_thread->eval_cache_hits = 0;
+  for (std::atomic<size_t> &count : main_thread->eval_updates) {
+    count = 0;
+  }
   for (Thread* helper : helpers) {
     helper->nodes = 0;
+    helper->pending_nodes = 0;
+    helper->eval_cache_probes = 0;
+    helper->eval_cache_hits = 0;
+    for (std::atomic<size_t> &count : helper->eval_updates) {
+      count = 0;
+    }
+  }
+}
+
+void ThreadPool::set_eval_cache_size(size_t MB) {
+  // Round down to a power of two number of entries for cheap indexing.
+  const size_t max_entries = (MB << 20) / sizeof(EvalCacheEntry);
+  eval_cache_entries = 0;
+  if (max_entries > 0) {
+    eval_cache_entries = 1;
+    while (2 * eval_cache_entries <= max_entries) {
+      eval_cache_entries *= 2;
+    }
+  }
+  main_thread->set_eval_cache_size(eval_cache_entries);
+  for (Thread* helper : helpers) {
+    helper->set_eval_cache_size(eval_cache_entries);
+  }
+}
+
+void ThreadPool::clear_eval_caches() {
+  main_thread->clear_eval_cache();
+  for (Thread* helper : helpers) {
+    helper->clear_eval_cache();
+  }
+}
+
+size_t ThreadPool::get_eval_cache_probes() const {
+  size_t sum = main_thread->eval_cache_probes.load(std::memory_order_relaxed);
+  for (Thread* helper : helpers) {
+    sum += helper->eval_cache_probes.load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+size_t ThreadPool::get_eval_cache_hits() const {
+  size_t sum = main_thread->eval_cache_hits.load(std::memory_order_relaxed);
+  for (Thread* helper : helpers) {
+    sum += helper->eval_cache_hits.load(std::memory_order_relaxed);
   }
+  return sum;
+}
+
+size_t ThreadPool::get_eval_updates(const EvalUpdateType type) const {
+  size_t sum = main_thread->eval_updates[type].load(std::memory_order_relaxed);
+  for (Thread* helper : helpers) {
+    sum += helper->eval_updates[type].load(std::memory_order_relaxed);
+  }
+  return sum;
 }
 
 template int32_t Thread::get_continuation_score<1>(const PieceType opp_piecetype, const Square opp_des,
@@ -372,6 +533,8 @@ template void Thread::update_continuation_score<2>(const PieceType opp_piecetype
 
 void SetNumThreads(int32_t value) { Threads.set_num_threads(value); }
 size_t GetNumThreads() { return Threads.get_thread_count(); }
+void SetEvalCacheSize(int32_t MB) { Threads.set_eval_cache_size(MB); }
+void SetSharedErrorHistory(bool enabled) { Threads.set_shared_error_histories(enabled); }
 
 #ifdef TUNE
 
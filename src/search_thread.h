@@ -28,10 +28,12 @@
 #ifndef SRC_SEARCH_THREAD_H_
 #define SRC_SEARCH_THREAD_H_
 
+#include "allocations.h"
 #include "board.h"
 #include "general/types.h"
 #include "general/settings.h"
 #include "net_types.h"
+#include "large_pages.h"
 #include <array>
 #include <cstring>
 #include <thread>
@@ -48,6 +50,58 @@ struct PieceTypeAndDestination {
   Square des;
 };
 
+// Raw network output of a previously evaluated position.
+struct EvalCacheEntry {
+  HashType hash;
+  Score score;
+};
+
+// How the network state of an evaluated position was obtained.
+enum EvalUpdateType {
+  kEvalFromScratch, // Recomputed for all pieces
+  kEvalIncremental, // Updated from the parent position
+  kEvalChained,     // Updated over several moves from an earlier ancestor
+  kNumEvalUpdateTypes
+};
+
+// Per thread histories which are large enough to suffer from TLB misses. They
+// are allocated as one block, so they can be backed by huge pages.
+struct LargeHistories {
+  Array3d<Array2d<int32_t, 6, 64>, 2, 6, 64> continuation_history;
+  ErrorHistory pawn_error_history;
+  ErrorHistory major_error_history;
+  ErrorHistory minor_error_history;
+  Array2d<ErrorHistory, kNumRngHash, 4> rng_error_history;
+};
+
+// Error histories shared by all threads when enabled with the SharedErrorHistory
+// option. Helpers then learn corrections together instead of each on its own.
+// Updates from different threads may race, relaxed atomics keep the occasional
+// lost update well defined.
+using SharedErrorHistory = Array2d<std::atomic<float>, kErrorHistorySize, 2>;
+
+struct SharedHistories {
+  void clear();
+
+  // Every table starts on its own cache line, so writes to the end of one table
+  // do not invalidate the start of the next.
+  alignas(64) SharedErrorHistory pawn_error_history;
+  alignas(64) SharedErrorHistory major_error_history;
+  alignas(64) SharedErrorHistory minor_error_history;
+};
+
+constexpr size_t kNodeBatch = 64;
+
+// A root move with the last result of its MultiPV line and the nodes the
+// thread has spent on it.
+struct RootMove {
+  Move move;
+  Score score;
+  Depth depth;
+  std::vector<Move> pv;
+  size_t nodes = 0;
+};
+
 struct Thread {
   Thread();
   ~Thread();
@@ -59,20 +113,25 @@ struct Thread {
     std::memset(&killers, 0, sizeof(killers));
     std::memset(&counter_moves, 0, sizeof(counter_moves));
     std::memset(&history, 0, sizeof(history));
-    std::memset(&continuation_history, 0, sizeof(continuation_history));
+    std::memset(&histories->continuation_history, 0, sizeof(histories->continuation_history));
     
     // Error histories
-    std::memset(&pawn_error_history, 0, sizeof(pawn_error_history));
-    std::memset(&major_error_history, 0, sizeof(major_error_history));
-    std::memset(&minor_error_history, 0, sizeof(minor_error_history));
-    std::memset(&rng_error_history, 0, sizeof(rng_error_history));
+    std::memset(&histories->pawn_error_history, 0, sizeof(histories->pawn_error_history));
+    std::memset(&histories->major_error_history, 0, sizeof(histories->major_error_history));
+    std::memset(&histories->minor_error_history, 0, sizeof(histories->minor_error_history));
+    std::memset(&histories->rng_error_history, 0, sizeof(histories->rng_error_history));
     
     for (size_t idx = 0; idx < evaluations.size(); ++idx) {
       evaluations[idx].pieces.clear();
+      q_evaluations[idx].pieces.clear();
+      evaluations[idx].hash = 0;
+      q_evaluations[idx].hash = 0;
       for (size_t j = 0; j < full_block_size; ++j) {
         evaluations[idx].global_features[j] = 0;
+        q_evaluations[idx].global_features[j] = 0;
       }
     }
+    clear_eval_cache();
     
     initialized = true;
   }
@@ -114,9 +173,59 @@ struct Thread {
 
   PieceTypeAndDestination get_previous_move(Depth moves_ago) const;
 
+  bool probe_eval_cache(const HashType hash, Score &score) {
+    if (eval_cache.empty()) {
+      return false;
+    }
+    eval_cache_probes.store(eval_cache_probes.load(std::memory_order_relaxed) + 1,
+                            std::memory_order_relaxed);
+    const EvalCacheEntry &entry = eval_cache[hash & (eval_cache.size() - 1)];
+    if (entry.hash != hash || entry.score == kNoScore) {
+      return false;
+    }
+    eval_cache_hits.store(eval_cache_hits.load(std::memory_order_relaxed) + 1,
+                          std::memory_order_relaxed);
+    score = entry.score;
+    return true;
+  }
+  void save_eval_cache(const HashType hash, const Score score) {
+    if (!eval_cache.empty()) {
+      eval_cache[hash & (eval_cache.size() - 1)] = { hash, score };
+    }
+  }
+  void set_eval_cache_size(size_t num_entries);
+  void clear_eval_cache();
+
+  void count_eval_update(const EvalUpdateType type) {
+    eval_updates[type].store(eval_updates[type].load(std::memory_order_relaxed) + 1,
+                             std::memory_order_relaxed);
+  }
+
   Depth get_height() const;
+  // Nodes are counted locally and published in batches, so other threads
+  // reading the count rarely need to refetch its cache line.
   void inc_nodes() {
-    nodes.store(nodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (++pending_nodes >= kNodeBatch) {
+      publish_nodes();
+    }
+  }
+  void publish_nodes() {
+    nodes.store(nodes.load(std::memory_order_relaxed) + pending_nodes, std::memory_order_relaxed);
+    pending_nodes = 0;
+  }
+  // Only valid on the thread itself.
+  size_t get_local_nodes() const {
+    return nodes.load(std::memory_order_relaxed) + pending_nodes;
+  }
+
+  void add_root_move_nodes(const Move move, const size_t move_nodes) {
+    for (RootMove &root_move : root_moves) {
+      if (root_move.move == move) {
+        root_move.nodes += move_nodes;
+        return;
+      }
+    }
+    root_moves.push_back({ move, kNoScore, 0, {}, move_nodes });
   }
   
   // Thread Pool Management Functions
@@ -132,23 +241,35 @@ struct Thread {
   //Data for search local to the thread
   Board board;
   Move best_root_move;
+  size_t root_split_offset = 0;
+  std::vector<Move> excluded_root_moves;
+  std::vector<RootMove> pv_lines;
+  std::vector<RootMove> root_moves;
   Depth current_depth;
   Array2d<Move, 1024, 2> killers;
   Array3d<Move, 2, 6, 64> counter_moves;
   Array3d<int32_t, 2, 64, 64> history;
-  Array3d<Array2d<int32_t, 6, 64>, 2, 6, 64> continuation_history;
-  ErrorHistory pawn_error_history;
-  ErrorHistory major_error_history;
-  ErrorHistory minor_error_history;
-  Array2d<ErrorHistory, kNumRngHash, 4> rng_error_history;
+  large_pages::Allocation histories_allocation;
+  LargeHistories *histories;
   std::array<PieceTypeAndDestination, settings::kMaxDepth> passed_moves;
   std::array<PartialEvaluation, settings::kMaxDepth> evaluations;
+  std::array<QPartialEvaluation, settings::kMaxDepth> q_evaluations;
+  std::vector<EvalCacheEntry> eval_cache;
+  std::atomic<size_t> eval_cache_probes;
+  std::atomic<size_t> eval_cache_hits;
+  std::array<std::atomic<size_t>, kNumEvalUpdateTypes> eval_updates;
   Depth root_height;
   std::array<Score, settings::kMaxDepth> static_scores;
-  std::atomic<size_t> nodes;
+  size_t pending_nodes = 0;
+  // Heap allocations during the last search, only counted with TRACK_ALLOCATIONS.
+  allocations::Counts search_allocations;
+
+  // Read by other threads during the search, so they are kept on their own
+  // cache line apart from data written at every node.
+  alignas(64) std::atomic<size_t> nodes;
   std::atomic<size_t> max_depth;
   
-  std::thread native_thread;
+  alignas(64) std::thread native_thread;
   std::mutex mutex;
   std::condition_variable cv;
   bool run = false;
@@ -158,21 +279,36 @@ struct Thread {
 
 struct ThreadPool {
   ThreadPool();
+  ~ThreadPool();
   //Set number of threads including main thread
   void set_num_threads(size_t num_threads);
   void clear_killers_and_countermoves();
   void reset_depths();
 
   size_t get_thread_count() const;
+  // Sum of published node counts, each thread may hold back up to kNodeBatch.
   size_t get_node_count() const;
 
   size_t get_max_depth() const;
   void reset_node_count();
 
+  // Size is given in MB per thread. A size of zero disables the cache.
+  void set_eval_cache_size(size_t MB);
+  void clear_eval_caches();
+  size_t get_eval_cache_probes() const;
+  size_t get_eval_cache_hits() const;
+  size_t get_eval_updates(const EvalUpdateType type) const;
+
+  // Shared histories are null unless enabled.
+  void set_shared_error_histories(bool enabled);
+
   std::atomic<bool> is_searching;
   std::atomic_bool end_search;
   std::vector<Thread*> helpers;
   Thread* main_thread;
+  size_t eval_cache_entries;
+  large_pages::Allocation shared_histories_allocation;
+  SharedHistories *shared_histories;
 };
 
 //The only instance of Threads
@@ -180,6 +316,8 @@ extern ThreadPool Threads;
 
 void SetNumThreads(int32_t value);
 size_t GetNumThreads();
+void SetEvalCacheSize(int32_t MB);
+void SetSharedErrorHistory(bool enabled);
 
 #ifdef TUNE
 #define OPTION(x) \
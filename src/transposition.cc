@@ -26,16 +26,26 @@
 
 #include "transposition.h"
 #include "net_evaluation.h"
+#include "numa.h"
+#include "large_pages.h"
+#include "general/settings.h"
 #include <array>
+#include <atomic>
 #include <cassert>
 #include <cstring>
-#include <cstdlib>            // for aligned_alloc, free
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
 #include <optional>
 #include <vector>
 #include <thread>
 
 #if defined(__linux__)
-  #include <sys/mman.h>       // for madvise/MADV_HUGEPAGE
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
 #endif
 
 namespace {
@@ -64,106 +74,494 @@ Score tt_score_to_score(Score score, int32_t num_made_moves) {
 
 namespace table {
 
-struct alignas(64) EntryBucket : public std::array<Entry, 4>{};
+// A bucket holds one cache line worth of entries. The data of each entry is a
+// single atomic word, the 16 bit key is stored xored with a fold of that word.
+// An entry whose parts were written by different threads thus fails validation
+// instead of returning mixed information.
+constexpr size_t kBucketEntries = 6;
+constexpr size_t kMainEntries = kBucketEntries - 1;
+constexpr size_t kPVEntryIdx = kBucketEntries - 1;
+
+inline uint16_t FoldData(const uint64_t data) {
+  return static_cast<uint16_t>(data ^ (data >> 16) ^ (data >> 32) ^ (data >> 48));
+}
+
+struct alignas(64) EntryBucket {
+  Entry load(const size_t i) const {
+    Entry entry;
+    const uint64_t entry_data = data[i].load(std::memory_order_relaxed);
+    entry.key = keys[i].load(std::memory_order_relaxed) ^ FoldData(entry_data);
+    entry.set_data(entry_data);
+    return entry;
+  }
+  void store(const size_t i, const Entry &entry) {
+    const uint64_t entry_data = entry.get_data();
+    keys[i].store(entry.key ^ FoldData(entry_data), std::memory_order_relaxed);
+    data[i].store(entry_data, std::memory_order_relaxed);
+  }
+
+  std::array<std::atomic<uint16_t>, kBucketEntries> keys;
+  std::array<std::atomic<uint64_t>, kBucketEntries> data;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+static_assert(sizeof(EntryBucket) == 64);
 
 // In addition to the main table, a subtable is used for improved PV entry redundancy.
 // PV entries are stored in both and TT size is sum of size of main table and PV table.
 
 namespace {
-  
-EntryBucket* _table = nullptr;
+
+// A single table shared by all threads whose pages are interleaved across NUMA
+// nodes, or one replica per node which is only used by threads on that node.
+std::vector<EntryBucket*> _tables;
+std::vector<large_pages::Allocation> _allocations;
+bool allocation_reported = false;
+bool replicate_per_node = false;
 size_t _table_size = 0;
+size_t _table_MB = 0;
 uint8_t current_generation = 0;
 
-void* AlignedAlloc(size_t alignment, size_t size) {
-#if defined(_WIN32)
-    return _aligned_malloc(size, alignment);
-#else
-    return std::aligned_alloc(alignment, size);
+// Tables saved to or mapped from disk start with a header identifying their
+// layout. The buckets follow at a page aligned offset.
+constexpr char kHashFileMagic[8] = {'W', 'i', 'n', 't', 'e', 'r', 'T', 'T'};
+constexpr uint32_t kHashFileFormat = 1;
+constexpr size_t kHashFileHeaderBytes = 4096;
+
+struct HashFileHeader {
+  char magic[8];
+  uint32_t format;
+  char engine_version[20];
+  uint64_t table_MB;
+  uint64_t bucket_count;
+  uint8_t generation;
+};
+
+HashFileHeader CreateHeader() {
+  HashFileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kHashFileMagic, sizeof(header.magic));
+  header.format = kHashFileFormat;
+  std::strncpy(header.engine_version, settings::engine_version.c_str(),
+               sizeof(header.engine_version) - 1);
+  header.table_MB = _table_MB;
+  header.bucket_count = _table_size;
+  header.generation = current_generation;
+  return header;
+}
+
+// Entries of other engine versions may not be compatible, even if their size is.
+bool IsCompatible(const HashFileHeader &header) {
+  HashFileHeader expected = CreateHeader();
+  return std::memcmp(header.magic, expected.magic, sizeof(header.magic)) == 0
+      && header.format == expected.format
+      && std::strncmp(header.engine_version, expected.engine_version,
+                      sizeof(header.engine_version)) == 0;
+}
+
+// Clearing or first touching a large table takes seconds, so it is done in the
+// background. While a clear is in progress, entries written before it started
+// are treated as empty based on their generation.
+struct BackgroundWork {
+  ~BackgroundWork() {
+    finish(true);
+  }
+  void start(std::function<void()> work) {
+    finish(true);
+    thread = std::thread(work);
+  }
+  // Waits for the current work, which may be asked to stop early.
+  void finish(const bool cancel_work) {
+    if (thread.joinable()) {
+      cancel = cancel_work;
+      thread.join();
+      cancel = false;
+    }
+  }
+
+  std::thread thread;
+  std::atomic<bool> cancel = false;
+};
+
+std::atomic<bool> clear_in_progress = false;
+uint8_t clear_generation = 0;
+
+// The table can be backed by a memory mapped file set with the HashFile option.
+std::string hash_file;
+HashFileHeader *mapped_header = nullptr;
+size_t mapped_bytes = 0;
+bool mapped_table_was_warm = false;
+
+BackgroundWork background;
+
+inline EntryBucket* LocalTable() {
+  return _tables[_tables.size() == 1 ? 0 : numa::GetCurrentNode()];
+}
+
+}
+
+void UpdateGeneration() {
+  current_generation += (0x1 << 2);
+  if (mapped_header) {
+    mapped_header->generation = current_generation;
+  }
+}
+
+namespace {
+
+void ClearBuckets(EntryBucket *table, const size_t start, const size_t end) {
+  for (size_t idx = start; idx < end; ++idx) {
+    for (size_t i = 0; i < kBucketEntries; ++i) {
+      table[idx].keys[i].store(0, std::memory_order_relaxed);
+      table[idx].data[i].store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+// Writes to every page without changing its contents, so fresh pages are placed
+// on the node of the touching thread while the table may already be in use.
+void TouchBuckets(EntryBucket *table, const size_t start, const size_t end) {
+  constexpr size_t kBucketsPerPage = 4096 / sizeof(EntryBucket);
+  for (size_t idx = start; idx < end; idx += kBucketsPerPage) {
+    table[idx].data[0].fetch_or(0, std::memory_order_relaxed);
+  }
+}
+
+// Applies work to all buckets of all tables in parallel. Stops early if the
+// background work is cancelled. The search thread count has to be read by the
+// caller, as the pool may be resized while this runs in the background.
+void ForEachStripe(void (*work)(EntryBucket*, size_t, size_t),
+                   const size_t num_search_threads) {
+  // Figure out how many threads to use
+  constexpr size_t kMinMBPerThread = 32;
+  const size_t num_nodes = numa::GetNumNodes();
+  const size_t total_bytes = _table_size * sizeof(EntryBucket);
+  const size_t total_mb = total_bytes >> 20;
+  size_t max_threads_by_mem = std::max<size_t>(1, total_mb / kMinMBPerThread);
+  
+  // Pages are placed on the node of the thread which first touches them, so a
+  // shared table needs a thread on every node to be interleaved.
+  size_t thread_count = std::min(std::max(num_search_threads, num_nodes),
+                                 max_threads_by_mem);
+
+  // Stripes of 2MB are assigned round robin, so consecutive stripes of a shared
+  // table are handled by threads on different nodes.
+  constexpr size_t kStripeBuckets = (2 << 20) / sizeof(EntryBucket);
+  const size_t num_stripes = (_table_size + kStripeBuckets - 1) / kStripeBuckets;
+  auto stripes = [work, num_stripes](EntryBucket *table, size_t first, size_t step) {
+    for (size_t stripe = first; stripe < num_stripes && !background.cancel; stripe += step) {
+      work(table, stripe * kStripeBuckets,
+           std::min((stripe + 1) * kStripeBuckets, _table_size));
+    }
+  };
+
+  // Use the calling thread in case we only want one thread.
+  if (thread_count == 1 && _tables.size() == 1) {
+    stripes(_tables[0], 0, 1);
+    return;
+  }
+
+  std::vector<std::thread> threads;
+  threads.reserve(thread_count * _tables.size());
+  if (_tables.size() == 1) {
+    for (size_t i = 0; i < thread_count; ++i) {
+      threads.emplace_back([i, thread_count, num_nodes, &stripes]() {
+        numa::BindThisThreadToNode(i % num_nodes);
+        stripes(_tables[0], i, thread_count);
+      });
+    }
+  }
+  else {
+    // Every replica is handled by threads bound to its own node.
+    const size_t threads_per_table = std::max<size_t>(1, thread_count / _tables.size());
+    for (size_t node = 0; node < _tables.size(); ++node) {
+      for (size_t i = 0; i < threads_per_table; ++i) {
+        threads.emplace_back([node, i, threads_per_table, &stripes]() {
+          numa::BindThisThreadToNode(node);
+          stripes(_tables[node], i, threads_per_table);
+        });
+      }
+    }
+  }
+
+  for (auto& t : threads) {
+    t.join();
+  }
+}
+
+// Detaches the current tables. Unmapping large tables can take a while, so
+// the returned function releasing them is run in the background.
+std::function<void()> RetireTables() {
+  std::vector<large_pages::Allocation> allocations;
+  allocations.swap(_allocations);
+  void *mapping = mapped_header;
+  size_t mapping_bytes = mapped_bytes;
+  mapped_header = nullptr;
+  _tables.clear();
+  return [allocations, mapping, mapping_bytes]() mutable {
+    for (large_pages::Allocation &allocation : allocations) {
+      large_pages::Free(allocation);
+    }
+#if defined(__linux__)
+    if (mapping) {
+      munmap(mapping, mapping_bytes);
+    }
 #endif
+  };
 }
 
-void AlignedFree(void* ptr) {
-#if defined(_WIN32)
-    _aligned_free(ptr);
+enum MapOutcome {
+  kMapped,       // The table lives in the file
+  kFileMismatch, // The file holds a different table and was left untouched
+  kMapFailed
+};
+
+// Maps the table from hash_file. A compatible file of the right size is reused
+// as is and a missing or empty file is created. Existing tables are never
+// truncated, so a saved table survives options arriving in any order. Pages are
+// read and written back lazily by the OS.
+MapOutcome MapHashFile() {
+#if defined(__linux__)
+  const size_t bytes = kHashFileHeaderBytes + _table_size * sizeof(EntryBucket);
+  int fd = open(hash_file.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    return kMapFailed;
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    close(fd);
+    return kMapFailed;
+  }
+  const bool reuse = file_stat.st_size != 0;
+  if (reuse) {
+    HashFileHeader header;
+    if (static_cast<size_t>(file_stat.st_size) != bytes
+        || pread(fd, &header, sizeof(header), 0) != sizeof(header)
+        || !IsCompatible(header) || header.bucket_count != _table_size) {
+      close(fd);
+      return kFileMismatch;
+    }
+  }
+  else if (ftruncate(fd, bytes) != 0) {
+    close(fd);
+    return kMapFailed;
+  }
+  void *ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (ptr == MAP_FAILED) {
+    return kMapFailed;
+  }
+  mapped_header = static_cast<HashFileHeader*>(ptr);
+  mapped_bytes = bytes;
+  mapped_table_was_warm = reuse;
+  if (reuse) {
+    current_generation = mapped_header->generation;
+  }
+  else {
+    current_generation = 0;
+    *mapped_header = CreateHeader();
+  }
+  _tables.push_back(reinterpret_cast<EntryBucket*>(
+      static_cast<char*>(ptr) + kHashFileHeaderBytes));
+  return kMapped;
 #else
-    std::free(ptr);
+  return kMapFailed;
 #endif
 }
 
+// Allocation itself is quick, as fresh memory is already zeroed. Releasing the
+// old tables and touching the new pages is left to the background.
+void AllocateTables() {
+  background.finish(true);
+  std::function<void()> release = RetireTables();
+  allocation_reported = false;
+  clear_in_progress = false;
+
+  if (!hash_file.empty()) {
+    const MapOutcome outcome = MapHashFile();
+    if (outcome == kMapped) {
+      background.start(release);
+      return;
+    }
+    if (outcome == kFileMismatch) {
+      // The file is mapped once Hash matches the table stored in it.
+      std::cout << "info string hash file " << hash_file
+                << " does not match the current Hash, using memory" << std::endl;
+    }
+    else {
+      std::cout << "info string failed to map hash file " << hash_file << std::endl;
+      hash_file.clear();
+    }
+  }
+
+  const size_t num_tables = replicate_per_node ? numa::GetNumNodes() : 1;
+  for (size_t i = 0; i < num_tables; ++i) {
+    _allocations.push_back(large_pages::Allocate(_table_size * sizeof(EntryBucket)));
+    _tables.push_back(static_cast<EntryBucket*>(_allocations.back().ptr));
+  }
+  current_generation = 0;
+  const size_t num_search_threads = search::GetNumThreads();
+  background.start([release, num_search_threads]() {
+    release();
+    ForEachStripe(TouchBuckets, num_search_threads);
+  });
+}
+
+}
+
+namespace {
+
+size_t BucketCount(const size_t MB_total) {
+  const size_t bytes = MB_total << 20;
+  return (bytes - (bytes % sizeof(EntryBucket))) / sizeof(EntryBucket);
 }
 
-void UpdateGeneration() {
-  current_generation += (0x1 << 2);
 }
 
 void SetTableSize(const int32_t MB_total_int) {
   const size_t MB_total = static_cast<size_t>(MB_total_int);
-  const size_t bytes = MB_total << 20;
-  
-  // Calculate new size (bucket count)
-  size_t new_byte_size = bytes - (bytes % sizeof(EntryBucket));
-  size_t new_bucket_count = new_byte_size / sizeof(EntryBucket);
+  size_t new_bucket_count = BucketCount(MB_total);
 
   // Only reallocate if size actually changed
-  if (new_bucket_count == _table_size && _table != nullptr) {
+  if (new_bucket_count == _table_size && !_tables.empty()) {
     return;
   }
 
-  // Free old table
-  if (_table) {
-    AlignedFree(_table);
-    _table = nullptr;
+  _table_size = new_bucket_count;
+  _table_MB = MB_total;
+  AllocateTables();
+}
+
+void ReportAllocation() {
+  if (allocation_reported || _tables.empty()) {
+    return;
+  }
+  std::cout << "info string hash " << _table_MB << "MB";
+  if (mapped_header) {
+    std::cout << (mapped_table_was_warm ? " resumed from " : " backed by new file ")
+              << hash_file << std::endl;
+    allocation_reported = true;
+    return;
+  }
+  if (_allocations.size() > 1) {
+    std::cout << " on " << _allocations.size() << " nodes";
   }
+  std::cout << " using " << large_pages::PageTypeName(_allocations[0].page_type)
+            << std::endl;
+  allocation_reported = true;
+}
 
-  _table_size = new_bucket_count;
-  
-  size_t alignment = 2 * 1024 * 1024; 
-    
-  // Fallback to 4096 if size is small
-  if (new_byte_size < alignment) alignment = 4096;
-  
-  if (new_byte_size % alignment) {
-    new_byte_size += alignment - (new_byte_size % alignment);
+void SetReplicatePerNode(bool value) {
+  replicate_per_node = value;
+  if (!_tables.empty()) {
+    AllocateTables();
   }
+}
 
-  _table = static_cast<EntryBucket*>(AlignedAlloc(alignment, new_byte_size));
-  
-  if (!_table) {
-    std::cerr << "Failed to allocate Hash Table!" << std::endl;
-    exit(EXIT_FAILURE);
+void SetHashFile(const std::string &file_name) {
+  hash_file = file_name;
+  if (!_tables.empty()) {
+    AllocateTables();
   }
-  
-#ifdef MADV_HUGEPAGE
-  madvise(_table, new_byte_size, MADV_HUGEPAGE);
-#endif
+}
 
-  ClearTable();
+bool SaveTable(const std::string &file_name) {
+  background.finish(false);
+  std::ofstream file(file_name, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  const HashFileHeader header = CreateHeader();
+  std::vector<char> header_bytes(kHashFileHeaderBytes, 0);
+  std::memcpy(header_bytes.data(), &header, sizeof(header));
+  file.write(header_bytes.data(), header_bytes.size());
+  file.write(reinterpret_cast<const char*>(_tables[0]), _table_size * sizeof(EntryBucket));
+  return file.good();
 }
 
+bool LoadTable(const std::string &file_name) {
+  std::ifstream file(file_name, std::ios::binary | std::ios::ate);
+  if (!file) {
+    return false;
+  }
+  const std::streamoff file_bytes = file.tellg();
+  file.seekg(0);
+  HashFileHeader header;
+  if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+      || !IsCompatible(header)) {
+    return false;
+  }
+  // Resizing wipes the live table, so the file must hold a complete table first.
+  if (header.table_MB == 0
+      || header.table_MB > static_cast<uint64_t>(std::numeric_limits<int32_t>::max())
+      || header.bucket_count != BucketCount(header.table_MB)
+      || static_cast<uint64_t>(file_bytes)
+          != kHashFileHeaderBytes + header.bucket_count * sizeof(EntryBucket)) {
+    return false;
+  }
+  SetTableSize(static_cast<int32_t>(header.table_MB));
+  if (header.bucket_count != _table_size) {
+    return false;
+  }
+  // The loaded contents replace everything an outstanding clear would remove.
+  background.finish(true);
+  clear_in_progress = false;
+  file.seekg(kHashFileHeaderBytes);
+  if (!file.read(reinterpret_cast<char*>(_tables[0]), _table_size * sizeof(EntryBucket))) {
+    ClearTable();
+    return false;
+  }
+  for (size_t i = 1; i < _tables.size(); ++i) {
+    std::memcpy(static_cast<void*>(_tables[i]), _tables[0], _table_size * sizeof(EntryBucket));
+  }
+  current_generation = header.generation;
+  if (mapped_header) {
+    mapped_header->generation = current_generation;
+  }
+  return true;
+}
+
+// Maps the hash to [0, _table_size) with a multiply-high instead of a division.
+// This mostly consumes the upper bits, the lowest 16 bits are used for the key.
 size_t HashFunction(const HashType hash) {
   assert(_table_size != 0);
-  return hash % _table_size;
+  return (static_cast<__uint128_t>(hash) * _table_size) >> 64;
+}
+
+uint16_t GetKey(const HashType hash) {
+  return static_cast<uint16_t>(hash);
+}
+
+// Generations are compared modulo wrap around, relative to the start of the clear.
+bool WrittenSinceClear(const Entry &entry) {
+  return static_cast<uint8_t>(entry.get_generation() - clear_generation)
+      <= static_cast<uint8_t>(current_generation - clear_generation);
 }
 
 bool ValidateHash(const Entry &entry, const HashType hash){
-  HashType best_move_cast = entry.get_best_move();
-  return entry.hash == (hash ^ best_move_cast);
+  // Empty entries have no bound set.
+  return entry.key == GetKey(hash) && entry.get_bound() != 0
+      && (!clear_in_progress.load(std::memory_order_relaxed) || WrittenSinceClear(entry));
 }
 
 std::optional<Entry> GetMainEntryIdx(const HashType hash, const size_t bucket) {
-  for (size_t i = 0; i < 3; ++i) {
-    if (ValidateHash(_table[bucket][i], hash)) {
-      return _table[bucket][i];
+  for (size_t i = 0; i < kMainEntries; ++i) {
+    Entry entry = LocalTable()[bucket].load(i);
+    if (ValidateHash(entry, hash)) {
+      return entry;
     }
   }
   return {};
 }
 
+void Prefetch(const HashType hash) {
+  __builtin_prefetch(&LocalTable()[HashFunction(hash)]);
+}
+
 std::optional<Entry> GetEntry(const HashType hash) {
   size_t idx = HashFunction(hash);
   std::optional<Entry> entry = GetMainEntryIdx(hash, idx);
-  Entry entry_pv = _table[idx][3];
+  Entry entry_pv = LocalTable()[idx].load(kPVEntryIdx);
 
   if (!ValidateHash(entry_pv, hash)) {
     return entry;
@@ -178,19 +576,22 @@ std::optional<Entry> GetEntry(const HashType hash) {
 }
 
 size_t GetIdxToReplace(const HashType hash, size_t idx) {
-  if (ValidateHash(_table[idx][0], hash)) {
+  const EntryBucket &bucket = LocalTable()[idx];
+  Entry entry = bucket.load(0);
+  if (ValidateHash(entry, hash)) {
     return 0;
   }
-  int worst_score = 1024 + static_cast<int>(_table[idx][0].depth)
-      - 512 * (_table[idx][0].get_generation() != current_generation);
+  int worst_score = 1024 + static_cast<int>(entry.depth)
+      - 512 * (entry.get_generation() != current_generation);
   size_t worst_idx = 0;
 
-  for (size_t i = 1; i <= 2; ++i) {
-    if (ValidateHash(_table[idx][i], hash)) {
+  for (size_t i = 1; i < kMainEntries; ++i) {
+    entry = bucket.load(i);
+    if (ValidateHash(entry, hash)) {
       return i;
     }
-    int score = 1024 + static_cast<int>(_table[idx][i].depth)
-          - 512 * (_table[idx][i].get_generation() != current_generation);
+    int score = 1024 + static_cast<int>(entry.depth)
+          - 512 * (entry.get_generation() != current_generation);
     if (score < worst_score) {
       worst_score = score;
       worst_idx = i;
@@ -206,21 +607,21 @@ void SaveEntry(const Board &board, const Move best_move, const Score score,
   size_t index = GetIdxToReplace(hash, idx);
 
   assert(idx < _table_size);
-  assert(index < 3);
+  assert(index < kMainEntries);
   assert(score.is_valid());
 
-  HashType best_move_cast = best_move;
-  hash ^= best_move_cast;
-  
-  if (_table[idx][index].hash != hash || _table[idx][index].depth <= depth + 2) {
+  EntryBucket &bucket = LocalTable()[idx];
+  const Entry old_entry = bucket.load(index);
+  if (!ValidateHash(old_entry, hash) || old_entry.get_best_move() != best_move
+      || old_entry.depth <= depth + 2) {
     Entry entry;
-    entry.hash = hash;
+    entry.key = GetKey(hash);
     entry.set_score(score, board);
     entry.set_best_move(best_move);
     entry.set_gen_and_bound(bound);
     assert(entry.get_generation() == current_generation);
     entry.depth = depth;
-    _table[idx][index] = entry;
+    bucket.store(index, entry);
   }
 }
 
@@ -228,60 +629,42 @@ void SavePVEntry(const Board &board, const Move best_move, const Score score, co
   HashType hash = board.get_hash();
   size_t idx = HashFunction(hash);
   size_t index = GetIdxToReplace(hash, idx); // HashFunction(hash);
-  size_t index_pv = 3;
 
-  assert(index < 3);
+  assert(index < kMainEntries);
 
-  HashType best_move_cast = best_move;
   Entry entry;
-  entry.hash = hash ^ best_move_cast;
+  entry.key = GetKey(hash);
   entry.set_score(score, board);
   entry.set_best_move(best_move);
   entry.depth = depth;
   entry.set_gen_and_bound(kExactBound);
-  _table[idx][index] = entry;
-  _table[idx][index_pv] = entry;
+  EntryBucket &bucket = LocalTable()[idx];
+  bucket.store(index, entry);
+  bucket.store(kPVEntryIdx, entry);
 }
 
 void ClearTable() {
+  background.finish(true);
+  ForEachStripe(ClearBuckets, search::GetNumThreads());
+  clear_in_progress = false;
   current_generation = 0;
-  
-  // Figure out how many threads to use
-  constexpr size_t kMinMBPerThread = 32;
-  const size_t total_bytes = _table_size * sizeof(EntryBucket);
-  const size_t total_mb = total_bytes >> 20;
-  size_t max_threads_by_mem = std::max<size_t>(1, total_mb / kMinMBPerThread);
-  
-  size_t thread_count = std::min(search::GetNumThreads(), max_threads_by_mem);
-  
-  // Use main thread in case we only want one thread.
-  if (thread_count == 1) {
-    std::memset(_table, 0, _table_size * sizeof(EntryBucket));
-    return;
-  }
-  
-  // Multithreaded initialization
-  std::vector<std::thread> threads;
-  threads.reserve(thread_count);
-  
-  const size_t total_buckets = _table_size;
-  const size_t chunk_size = total_buckets / thread_count;
-
-  for (size_t i = 0; i < thread_count; ++i) {
-    threads.emplace_back([i, thread_count, chunk_size, total_buckets]() {
-      const size_t start = i * chunk_size;
-      // Ensure the last thread picks up any remainder from integer division
-      const size_t end = (i == thread_count - 1) ? total_buckets : start + chunk_size;
-
-      if (start < end) {
-        std::memset(&_table[start], 0, (end - start) * sizeof(EntryBucket));
-      }
-    });
+  if (mapped_header) {
+    mapped_header->generation = current_generation;
   }
+}
 
-  for (auto& t : threads) {
-    t.join();
-  }
+void ClearTableAsync() {
+  background.finish(true);
+  UpdateGeneration();
+  clear_generation = current_generation;
+  clear_in_progress = true;
+  const size_t num_search_threads = search::GetNumThreads();
+  background.start([num_search_threads]() {
+    ForEachStripe(ClearBuckets, num_search_threads);
+    if (!background.cancel) {
+      clear_in_progress = false;
+    }
+  });
 }
 
 void Entry::set_score(const Score score_new, const Board &board) {
@@ -295,6 +678,22 @@ Score Entry::get_score(const Board &board) const {
   return tt_score_to_score(score, board.get_num_made_moves());
 }
 
+uint64_t Entry::get_data() const {
+  return static_cast<uint64_t>(static_cast<uint16_t>(win))
+       | (static_cast<uint64_t>(static_cast<uint16_t>(loss)) << 16)
+       | (static_cast<uint64_t>(best_move) << 32)
+       | (static_cast<uint64_t>(gen_and_bound) << 48)
+       | (static_cast<uint64_t>(depth) << 56);
+}
+
+void Entry::set_data(const uint64_t data) {
+  win = static_cast<int16_t>(data & 0xffff);
+  loss = static_cast<int16_t>((data >> 16) & 0xffff);
+  best_move = static_cast<uint16_t>((data >> 32) & 0xffff);
+  gen_and_bound = static_cast<uint8_t>((data >> 48) & 0xff);
+  depth = static_cast<uint8_t>(data >> 56);
+}
+
 void Entry::set_gen() {
   gen_and_bound = current_generation | get_bound();
 }
@@ -305,8 +704,11 @@ void Entry::set_gen_and_bound(uint8_t bound) {
 
 size_t GetHashfull() {
   size_t result = 0;
-  for (size_t i = 0; i < 1000; ++i) {
-    result += (_table[i][0].get_generation() == current_generation);
+  for (size_t i = 0; i < 200; ++i) {
+    for (size_t j = 0; j < kMainEntries; ++j) {
+      const Entry entry = LocalTable()[i].load(j);
+      result += (entry.get_bound() != 0 && entry.get_generation() == current_generation);
+    }
   }
   return result;
 }
@@ -30,6 +30,7 @@
 #include "general/types.h"
 #include "board.h"
 #include <optional>
+#include <string>
 
 namespace table {
 
@@ -63,7 +64,11 @@ struct Entry {
     *this = Entry{};
   }
 
-  HashType hash;         // 8 bytes
+  // All fields except the hash packed into a single word for atomic storage.
+  uint64_t get_data() const;
+  void set_data(const uint64_t data);
+
+  uint16_t key;          // 2 bytes, hash bits not used for the bucket index
 private:
   int16_t win;           // 2 bytes
   int16_t loss;          // 2 bytes
@@ -71,17 +76,32 @@ private:
   uint8_t gen_and_bound; // 1 byte
 public:
   uint8_t depth;         // 1 byte
-                         // 16 bytes total, 4 entries per cache line.
+                         // 10 bytes total, 6 entries per cache line.
 };
 
 void SetTableSize(const int32_t MB);
+// Prints the page type backing the table once after every reallocation.
+void ReportAllocation();
+// Keep a separate copy of the table on every NUMA node instead of interleaving.
+void SetReplicatePerNode(bool value);
+// Backs the table with a memory mapped file, an empty name disables this.
+void SetHashFile(const std::string &file_name);
+bool SaveTable(const std::string &file_name);
+// Resizes the table to the size stored in the file.
+bool LoadTable(const std::string &file_name);
 std::optional<Entry> GetEntry(const HashType hash);
 void SaveEntry(const Board &board, const Move best_move, const Score score,
                const Depth depth, const uint8_t bound = kLowerBound);
 void SavePVEntry(const Board &board, const Move best_move, const Score score, const Depth depth);
 
+// Prefetches the bucket of the position, should be called as early as possible.
+void Prefetch(const HashType hash);
+
 void UpdateGeneration();
 void ClearTable();
+// Returns immediately, entries from before the call are ignored until the
+// table has been cleared in the background.
+void ClearTableAsync();
 
 size_t GetHashfull();
 
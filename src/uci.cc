@@ -29,11 +29,14 @@
 #include "general/settings.h"
 #include "general/types.h"
 #include "move_order.h"
+#include "net_evaluation.h"
+#include "numa.h"
 #include "search.h"
 #include "search_thread.h"
 #include "transposition.h"
 #include "uci.h"
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
 #include <iostream>
@@ -102,10 +105,29 @@ struct UCICheck {
   }
 };
 
+struct UCIString {
+  std::string name;
+  void (*func)(const std::string &value);
+  std::string default_value;
+  std::string to_string() const {
+    return "option name " + name + " type string default "
+        + (default_value.empty() ? "<empty>" : default_value);
+  }
+};
+
+bool ponder = false;
+
+void SetPonder(bool ponder_) {
+  ponder = ponder_;
+}
+
 const std::vector<UCIOption> uci_options {
   {"Hash", table::SetTableSize, 32, 1, (1 << 20)},
   {"Threads", search::SetNumThreads, 1, 1, 1024},
+  {"EvalCache", search::SetEvalCacheSize, settings::kDefaultEvalCacheMB, 0, 1024},
   {"Contempt", search::SetContempt, 0, -100, 100},
+  {"MultiPV", search::SetMultiPV, 1, 1, 256},
+  {"HelperSkipPattern", search::SetHelperSkipPattern, 1, 0, 2},
 #ifdef TUNE
 #define OPTION(x, min, max) \
   {#x, search::Set##x, search::Get##x(), min, max},
@@ -150,9 +172,21 @@ const std::vector<UCIOption> uci_options {
 };
 
 const std::vector<UCICheck> uci_check_options {
+  {"Ponder", SetPonder, false},
   {"Armageddon", search::SetArmageddon, false},
   {"UCI_ShowWDL", search::SetUCIShowWDL, true},
   {"UCI_Chess960", settings::set_chess960_mode, false},
+  {"QuantizedEval", net_evaluation::SetQuantized, false},
+  {"NumaBind", numa::SetBinding, true},
+  {"NumaReplicateTT", table::SetReplicatePerNode, false},
+  {"SharedErrorHistory", search::SetSharedErrorHistory, false},
+  {"HelperRootSplit", search::SetHelperRootSplit, false},
+  {"RootMoveStats", search::SetRootMoveStats, false},
+  {"EvalStats", search::SetEvalStats, false},
+};
+
+const std::vector<UCIString> uci_string_options {
+  {"HashFile", table::SetHashFile, ""},
 };
 
 const std::string kEngineIsReady = "readyok";
@@ -167,9 +201,11 @@ struct Timer {
   size_t nodes;
   Depth moves_to_go;
   Depth search_depth;
+  std::vector<Move> search_moves;
 };
 
 void Go(Board *board, Timer timer) {
+  table::ReportAllocation();
   Move move = 0;
   if (timer.search_depth != 0) {
     move = search::DepthSearch((*board), timer.search_depth);
@@ -193,8 +229,15 @@ void Go(Board *board, Timer timer) {
     Milliseconds duration = Milliseconds(time);
     move = search::TimeSearch((*board), duration);
   }
+  // The GUI expects no bestmove before ponderhit or stop.
+  search::wait_for_ponderhit();
   if (move != kNullMove) {
-    std::cout << "bestmove " << parse::MoveToString(move) << std::endl;
+    std::cout << "bestmove " << parse::MoveToString(move);
+    const Move ponder_move = ponder ? search::GetPonderMove(*board, move) : kNullMove;
+    if (ponder_move != kNullMove) {
+      std::cout << " ponder " << parse::MoveToString(ponder_move);
+    }
+    std::cout << std::endl;
   }
   else {
     std::cout << "bestmove (none)" << std::endl;
@@ -227,10 +270,35 @@ void UCIIsReady(Board &board, const StrArgs) {
   Reply(kEngineIsReady);
 }
 
-void UCIGo(Board &board, const StrArgs tokens) {
+void UCIGo(Board &board, const StrArgs go_tokens) {
   int index = 1;
   search::end_search();
   Timer timer {};
+  // ponder and searchmoves are the only arguments without a single value.
+  bool go_ponder = false;
+  StrArgs tokens;
+  const MoveList legal_moves = board.GetMoves<kNonQuiescent>();
+  for (size_t i = 0; i < go_tokens.size(); ++i) {
+    if (Equals(go_tokens[i], "ponder")) {
+      go_ponder = true;
+    }
+    else if (Equals(go_tokens[i], "searchmoves")) {
+      // All following tokens which are legal moves belong to searchmoves.
+      while (i + 1 < go_tokens.size()) {
+        auto it = std::find_if(legal_moves.begin(), legal_moves.end(), [&](const Move move) {
+          return Equals(parse::MoveToString(move), go_tokens[i + 1]);
+        });
+        if (it == legal_moves.end()) {
+          break;
+        }
+        timer.search_moves.push_back(*it);
+        i++;
+      }
+    }
+    else {
+      tokens.push_back(go_tokens[i]);
+    }
+  }
   if (tokens.size() >= index+2) {
     while (tokens.size() >= index+2) {
       std::string arg = tokens[index++];
@@ -267,14 +335,23 @@ void UCIGo(Board &board, const StrArgs tokens) {
   else{
     timer.search_depth = 6;
   }
+  // Set before the search thread starts, a previous one may still be finishing.
+  search::SetSearchMoves(timer.search_moves);
+  search::set_pondering(go_ponder);
+  // Marked before the thread starts, so a quit right after go waits for bestmove.
+  search::Threads.is_searching = true;
   std::thread t(Go, &board, timer);
   t.detach();
 }
 
+void UCIPonderHit(Board &board, const StrArgs) {
+  search::ponder_hit();
+}
+
 void UCINewGame(Board &board, const StrArgs) {
   board = Board();
   search::clear_killers_and_counter_moves();
-  table::ClearTable();
+  table::ClearTableAsync();
   
 }
 
@@ -310,6 +387,18 @@ void UCISetOption(Board &board, const StrArgs tokens) {
       return;
     }
   }
+  for (const UCIString &option : uci_string_options) {
+    if (Equals(command, option.name)) {
+      index++;
+      // The value extends to the end of the line and may contain spaces.
+      std::string value;
+      for (; index < (int)tokens.size(); ++index) {
+        value += (value.empty() ? "" : " ") + tokens[index];
+      }
+      option.func(Equals(value, "<empty>") ? "" : value);
+      return;
+    }
+  }
 }
 
 void UCIPosition(Board &board, const StrArgs tokens) {
@@ -336,7 +425,7 @@ void UCIPosition(Board &board, const StrArgs tokens) {
     if (Equals(arg, "moves")) {
       while (index < tokens.size()) {
         Move move = parse::StringToMove(tokens[index++]);
-        std::vector<Move> moves = board.GetMoves<kNonQuiescent>();
+        MoveList moves = board.GetMoves<kNonQuiescent>();
         for (unsigned int i = 0; i < moves.size(); i++) {
           if (GetMoveSource(moves[i]) == GetMoveSource(move)
               && GetMoveDestination(moves[i]) == GetMoveDestination(move)
@@ -357,7 +446,7 @@ void UCIStop(Board &board , const StrArgs) {
 
 void UCIUci(Board &board, const StrArgs) {
   Reply(kEngineNamePrefix + settings::engine_name + " "
-        + settings::engine_version + " " + settings::compile_arch);
+        + settings::engine_version + " " + net_evaluation::GetBackendName());
   Reply(kEngineAuthorPrefix + settings::engine_author);
   for (const UCIOption &option : uci_options) {
     Reply(option.to_string());
@@ -365,6 +454,9 @@ void UCIUci(Board &board, const StrArgs) {
   for (const UCICheck &option : uci_check_options) {
     Reply(option.to_string());
   }
+  for (const UCIString &option : uci_string_options) {
+    Reply(option.to_string());
+  }
   #ifdef TUNE_ORDER
   move_order::PrintOptions();
   #endif
@@ -390,6 +482,7 @@ const std::vector<UCICommand> uci_commands {
   {"go", UCIGo},
   {"quit", UCIQuit},
   {"isready", UCIIsReady},
+  {"ponderhit", UCIPonderHit},
   {"position", UCIPosition},
   {"setoption", UCISetOption},
   {"stop", UCIStop},
@@ -398,6 +491,10 @@ const std::vector<UCICommand> uci_commands {
   // Non-Standard Commands
   {"can_repeat", commands::CheckIfRepetitionPossible},
   {"evaluate", commands::EvaluateBoard},
+  {"evaluate_file", commands::EvaluateFile},
+  {"save_hash", commands::SaveHash},
+  {"load_hash", commands::LoadHash},
+  {"eval_bench", commands::EvalBench},
   {"fen", commands::GetFEN},
   {"perft", commands::Perft},
   {"perft_test", commands::PerftTest}, 
@@ -407,6 +504,7 @@ const std::vector<UCICommand> uci_commands {
   {"print_moves_sorted", commands::PrintMovesSorted},
   {"see", commands::SEE},
   {"symmetry_test", commands::SymmetryTest},
+  {"quantization_test", commands::QuantizationTest},
   {"isdraw", commands::CheckIfDraw},
   {"spsa", SPSAFormatOptionPrint},
 #ifdef TUNE_ORDER